@@ -9,15 +9,41 @@
 #define ENABLE_MOTOR_PWM            1U
 
 /*
- * 1: use conflict-free LCD remap so core motors + Bluetooth + LCD can run together.
- * 0: use requirement sheet LCD pins (may conflict with motor IN2 / USART2).
+ * Main scheduling. Navigation is event driven: SysTick posts a sample event
+ * every NAV_SAMPLE_PERIOD_MS and the action deadline; edges found in a sample
+ * are posted as their own events. The CPU sleeps in WFI between events.
  */
-#define LCD_USE_CONFLICT_FREE_PINS  1U
-
-/* Main scheduling. */
-#define MAIN_LOOP_PERIOD_MS         20U
+#define NAV_SAMPLE_PERIOD_MS        20U
+#define NAV_EVENT_QUEUE_CAPACITY    16U
 #define LCD_REFRESH_PERIOD_MS       200U
 
+/*
+ * Cooperative task table (scheduler.c). Phase offsets keep the LCD refresh
+ * and the telemetry report from landing in the same millisecond; deadlines
+ * are relative to each release. Navigation has an execution budget instead.
+ */
+#define SCHED_NAV_BUDGET_MS         5U
+#define SCHED_LCD_OFFSET_MS         50U
+#define SCHED_LCD_DEADLINE_MS       100U
+#define SCHED_TELEMETRY_OFFSET_MS   150U
+#define SCHED_TELEMETRY_DEADLINE_MS 250U
+#define SCHED_COMMAND_PERIOD_MS     20U
+#define SCHED_COMMAND_OFFSET_MS     10U
+#define SCHED_COMMAND_DEADLINE_MS   20U
+#define SCHED_REPORT_EVERY          10U   /* telemetry runs between task statistics reports */
+
+/*
+ * 1: run sensors, control, UI and telemetry as CMSIS-RTOS2 (RTX5) threads
+ * instead of the cooperative task table (rtos_app.c). Needs the RTX5
+ * component of the Keil project. Stack sizes are bytes, multiples of 8.
+ */
+#define ENABLE_RTOS                 0U
+#define RTOS_SENSOR_STACK_BYTES     512U
+#define RTOS_CONTROL_STACK_BYTES    2048U
+#define RTOS_UI_STACK_BYTES         768U
+#define RTOS_TELEMETRY_STACK_BYTES  1024U
+#define RTOS_STATUS_QUEUE_DEPTH     2U
+
 /* OPB704 mark detection (A0). Active-low because collector is pulled up. */
 #define OPB704_ACTIVE_LOW           1U
 #define MARK_ADC_THRESHOLD          1800U
@@ -27,6 +53,15 @@
 /* 2Y0A21 25 cm threshold mapped to ADC count (12-bit @ 3.3V). */
 #define OBSTACLE_ADC_THRESHOLD_25CM 1750U
 
+/*
+ * 2Y0A21 linearization: cm = K / (adc - offset), anchored so the obstacle
+ * threshold maps to 25 cm. Output is clamped to the sensor's usable range.
+ */
+#define IR_RANGE_OFFSET_ADC         124U
+#define IR_RANGE_K_ADC_CM           (25U * (OBSTACLE_ADC_THRESHOLD_25CM - IR_RANGE_OFFSET_ADC))
+#define IR_RANGE_MIN_CM             10U
+#define IR_RANGE_MAX_CM             80U
+
 /* Counter + display behavior (single common-cathode 7-seg digit). */
 #define COUNTER_MAX_VALUE           9U
 
@@ -37,18 +72,260 @@
 #define TURN_90_MS                  560U
 #define TURN_180_MS                 1080U
 
+/*
+ * Online turn calibration. A 90 degree turn with its default duration and a
+ * wall ahead (TURN_CAL_MIN_WALL_CM..TURN_CAL_MAX_WALL_CM) compares the front
+ * distance before the turn with the side distance when it ends, early on its
+ * predicate or after a timed turn's full duration; the achieved angle over
+ * the elapsed time moves that direction's duration by at most
+ * TURN_CAL_MAX_STEP_MS per turn. A predicate turn that times out is rejected. TURN_CAL_SIDE_OFFSET_CM is what the side
+ * sensor reads minus what the front sensor reads for the same wall at a
+ * perfect 90 degree turn (sensor mounting, measure on the bench).
+ */
+#define ENABLE_TURN_CALIBRATION     1U
+#define TURN_CAL_MIN_WALL_CM        12U
+#define TURN_CAL_MAX_WALL_CM        45U
+#define TURN_CAL_SIDE_OFFSET_CM     0
+#define TURN_CAL_GAIN_PERCENT       50U
+#define TURN_CAL_MAX_STEP_MS        20U
+#define TURN_CAL_TREND_CM           2U
+
+/*
+ * Parameter persistence in 16 KB flash sector 3 (0x0800C000), the same on
+ * F401xC and F401xE. The Keil projects and the armclang script split the
+ * code into IROM1 below it and IROM2 from sector 4 on, so code never lands
+ * there. Records are appended and the sector is only erased when full.
+ */
+#define ENABLE_PARAM_FLASH          1U
+#define PARAM_FLASH_SECTOR          3U
+#define PARAM_FLASH_ADDR            0x0800C000UL
+#define PARAM_FLASH_SIZE            0x00004000UL
+
+/*
+ * Per-action safety guards, checked on every sensor update.
+ * Guards ignore the first ACTION_GUARD_SETTLE_MS of an action (filter lag).
+ * An abort preempts the action with a stop of ACTION_GUARD_STOP_MS and drops
+ * the rest of the plan; 0 replans in the same decision.
+ */
+#define ENABLE_ACTION_GUARDS        1U
+#define ACTION_GUARD_SETTLE_MS      60U
+#define ACTION_GUARD_STOP_MS        0U
+
+/*
+ * Sensor-terminated maneuvers: reverses and turns stop once the watched side
+ * reads farther than NAV_CLEAR_DISTANCE_CM; the step duration is the timeout.
+ * Turns run at least NAV_TURN_MIN_PERCENT of their duration before checking.
+ */
+#define NAV_CLEAR_DISTANCE_CM       35U
+#define NAV_TURN_MIN_PERCENT        60U
+
+/*
+ * Navigation mode (PARAM_NAV_MODE): 0 = discrete scenes only,
+ * 1 = reactive potential-field steering while the front is clear,
+ *     with the scene logic as fallback once the front is blocked.
+ */
+#define NAV_DEFAULT_MODE            0U
+#define STEER_SIDE_GAIN             4U   /* x0.1 percent per repulsion unit (1000/cm) */
+#define STEER_FRONT_GAIN            8U   /* x0.1 percent per cm inside STEER_FRONT_AVOID_CM */
+#define STEER_FRONT_AVOID_CM        60U
+#define STEER_MAX_TURN_PERCENT      35U
+
+/*
+ * Progress monitor: NAV_STALL_MIN_REPLANS replans within NAV_STALL_WINDOW_MS
+ * that stay inside NAV_STALL_MIN_PROGRESS_MM, or a repeating scene pattern
+ * inside NAV_STALL_OSC_PROGRESS_MM, trigger the escape maneuver.
+ */
+#define NAV_STALL_HISTORY           8U
+#define NAV_STALL_WINDOW_MS         12000U
+#define NAV_STALL_MIN_REPLANS       4U
+#define NAV_STALL_MIN_PROGRESS_MM   300U
+#define NAV_STALL_OSC_PROGRESS_MM   600U
+#define NAV_ESCAPE_REVERSE_MS       1800U
+#define NAV_ESCAPE_TURN_PERCENT     150U
+
+/*
+ * Scan maneuver (NAV_ACTION_SCAN): sweep SCAN_ARC_DEG centered on the blocked
+ * heading at SCAN_TURN_PERCENT, sampling the front sensor every cycle into
+ * SCAN_BINS bins, then turn to the most open bin. With ENABLE_SCAN_TURNS the
+ * scene 2 alternate turn scans when route memory and map have no preference.
+ */
+#define ENABLE_SCAN_TURNS           1U
+#define SCAN_ARC_DEG                180U
+#define SCAN_BINS                   9U
+#define SCAN_TURN_PERCENT           50U
+#define SCAN_TIMEOUT_MS             6000U
+
+/* Longest runtime scene plan override accepted by the parameter store. */
+#define NAV_PLAN_MAX_STEPS          4U
+
+/* Pending maneuver slots; must be a power of two (ring buffer index mask). */
+#define NAV_ACTION_QUEUE_CAPACITY   8U
+
 /* PWM speed setpoints (0..100). */
 #define MOTOR_SPEED_FORWARD_PERCENT 72U
 #define MOTOR_SPEED_REVERSE_PERCENT 62U
 #define MOTOR_SPEED_TURN_PERCENT    60U
 
+/*
+ * Approach speed scheduling: forward duty follows the front distance
+ * (cruise when open, ramp down toward the obstacle) and is cut further when
+ * time-to-contact drops below APPROACH_MIN_TTC_MS. Because the car arrives
+ * slowly, the front counts as blocked only at APPROACH_BLOCK_CM.
+ * 0 keeps the constant MOTOR_SPEED_FORWARD_PERCENT and the 25 cm ADC threshold.
+ */
+#define ENABLE_APPROACH_SPEED_SCHEDULE 1U
+#define APPROACH_CRUISE_PERCENT     90U
+#define APPROACH_MIN_PERCENT        40U
+#define APPROACH_SLOW_START_CM      60U
+#define APPROACH_BLOCK_CM           18U
+#define APPROACH_MIN_TTC_MS         400U
+
+/*
+ * Dead-reckoning pose (tune during on-car calibration).
+ * Wheel speed model: linear from the deadband duty up to POSE_WHEEL_SPEED_MM_S_AT_100.
+ */
+#define POSE_WHEEL_SPEED_MM_S_AT_100 600U
+#define POSE_DUTY_DEADBAND_PERCENT  20U
+#define POSE_TRACK_WIDTH_MM         130U
+#define MARK_SPACING_MM             300U
+#define MARK_WIDTH_MM               20U
+#define POSE_MARK_GAIN              0.25f /* share of the spacing error applied per mark */
+#define POSE_WALL_SEGMENT_MM        200U  /* straight travel needed for one wall heading fix */
+#define POSE_WALL_MAX_CM            45U
+#define POSE_WALL_GAIN              0.3f
+
+/*
+ * Measured speed from mark edge timing (DWT timestamps, interpolated between
+ * ADC samples). With ENABLE_MARK_SPEED_MODEL the pose uses the online fitted
+ * duty->speed line instead of the fixed model above; the fixed model only
+ * enters the fit as two prior points of weight SPEED_MODEL_PRIOR_WEIGHT.
+ */
+#define ENABLE_MARK_SPEED_MODEL     1U
+#define SPEED_MODEL_FORGET          0.9f
+#define SPEED_MODEL_PRIOR_WEIGHT    0.5f
+#define SPEED_MODEL_PRIOR_LOW_DUTY  50U
+
+/*
+ * Occupancy grid: OCC_GRID_SIZE^2 cells of 2 bits, centered on the start pose
+ * (64 x 64 x 10 cm = 6.4 m square in 1 KB of SRAM). Beams are traced up to
+ * OCC_MAX_RANGE_CM; longer readings only clear cells.
+ */
+#define OCC_GRID_SIZE               64U
+#define OCC_GRID_CELL_MM            100U
+#define OCC_MAX_RANGE_CM            60U
+#define OCC_QUERY_RANGE_CM          50U
+
+/*
+ * Branch / dead-end memory. A branch is recognized again when the mark count
+ * matches and either the pose is within ROUTE_MATCH_RADIUS_MM or the time
+ * since the last mark is within ROUTE_MATCH_TIME_MS. A recorded dead end
+ * counts against a turn side when it lies within ROUTE_MATCH_RADIUS_MM of
+ * the line that side points along.
+ */
+#define ROUTE_MAX_BRANCHES          16U
+#define ROUTE_MAX_DEAD_ENDS         8U
+#define ROUTE_MATCH_RADIUS_MM       250U
+#define ROUTE_MATCH_TIME_MS         400U
+
 /* Buzzer feedback timings. */
 #define BEEP_MARK_MS                50U
 #define BEEP_OBSTACLE_MS            120U
 #define BEEP_DONE_ON_MS             180U
 #define BEEP_DONE_OFF_MS            80U
 
-/* Optional UART report interval (HC-05). */
+/*
+ * Buzzer sequencer (buzzer.c). Patterns are queued as on/off segments and
+ * played from the TIM10 update interrupt. BUZZER_DRIVE_TONE 0 holds the pin
+ * high for an active buzzer; 1 toggles it at the segment tone for a passive
+ * one. BUZZER_QUEUE_CAPACITY must be a power of two.
+ */
+#define BUZZER_DRIVE_TONE           0U
+#define BUZZER_TONE_HZ              2000U
+#define BUZZER_QUEUE_CAPACITY       16U
+#define BUZZER_IRQ_PRIORITY         6U
+
+/*
+ * LED pattern engine (indicators.c), stepped by TIM11 every INDICATOR_TICK_MS.
+ * A fault code blinks both LEDs `code` times, then pauses, and repeats.
+ */
+#define INDICATOR_TICK_MS           10U
+#define INDICATOR_QUEUE_CAPACITY    8U
+#define INDICATOR_FAULT_ON_MS       200U
+#define INDICATOR_FAULT_OFF_MS      250U
+#define INDICATOR_FAULT_PAUSE_MS    1200U
+#define INDICATOR_IRQ_PRIORITY      7U
+
+/*
+ * 1: time seven-segment and LCD-nibble updates through HAL_GPIO_WritePin and
+ * through the shadow output stage (gpio_out.c) at boot and report the
+ * average cycles per update over Bluetooth.
+ */
+#define GPIO_OUT_BENCHMARK          0U
+#define GPIO_OUT_BENCHMARK_ROUNDS   64U
+
+/*
+ * Driver backend for the hot paths: 0 = HAL, 1 = STM32F4 LL (inline register
+ * access from the stm32f4xx_ll_* headers). Covers the ADC reads in sensors.c,
+ * the PWM compare updates in motor.c, the buzzer pin and USART2 TX in
+ * bluetooth.c; peripheral init stays on the HAL either way. The ps1 build
+ * passes -Backend LL as a define, hence the #ifndef.
+ * DRIVER_BACKEND_BENCHMARK reports the per-call cycles of the selected
+ * backend at boot as a `bench=backend,...` line (minimum over the rounds).
+ */
+#ifndef DRIVER_BACKEND_LL
+#define DRIVER_BACKEND_LL           0U
+#endif
+#define DRIVER_BACKEND_BENCHMARK    0U
+#define DRIVER_BACKEND_BENCHMARK_ROUNDS 32U
+
+/*
+ * HC-05 transmit ring (bluetooth.c), drained by USART2 DMA; size is a power
+ * of two. When a message does not fit, BLUETOOTH_TX_DROP_OLDEST 1 discards
+ * the queued backlog that has not started yet, 0 drops the new message.
+ */
+#define BLUETOOTH_TX_BUFFER_SIZE    512U
+#define BLUETOOTH_TX_DROP_OLDEST    1U
+#define BLUETOOTH_IRQ_PRIORITY      8U
+
+/*
+ * Host command channel (host_cmd.c): USART2 RX by circular DMA into a
+ * power-of-two ring; commands are ASCII lines, ended by CR/LF/';' or an
+ * idle line. Parsed changes are staged (HOST_CMD_QUEUE_CAPACITY, power of
+ * two) and applied by navigation between two decisions.
+ */
+#define BLUETOOTH_RX_ENABLE         1U
+#define BLUETOOTH_RX_BUFFER_SIZE    256U
+#define HOST_CMD_QUEUE_CAPACITY     8U
+#define HOST_CMD_MAX_LINE           96U
+
+/*
+ * HC-05 link rate (hc05_link.c). BLUETOOTH_AUTOBAUD 1 probes the module with
+ * AT commands at boot over its KEY line (HC05_KEY, PB12) and moves it to
+ * BLUETOOTH_BAUD_TARGET; the rate that answered is saved as PARAM_BT_BAUD.
+ * Without a reply (KEY not wired) USART2 stays at the saved rate, which
+ * starts at the factory BLUETOOTH_BAUD_DEFAULT. Targets above 460800 are out
+ * of tolerance with USART2 on the 42 MHz APB1 clock.
+ */
+#define BLUETOOTH_AUTOBAUD          1U
+#define BLUETOOTH_BAUD_DEFAULT      9600U
+#define BLUETOOTH_BAUD_TARGET       115200U
+#define BLUETOOTH_AT_TIMEOUT_MS     50U
+#define BLUETOOTH_KEY_SETTLE_MS     20U
+#define BLUETOOTH_AT_RESET_MS       1000U
+
+/*
+ * Telemetry encoding: 0 = ASCII lines, 1 = binary frames (telemetry_frame.h):
+ * a 32-byte packed status in 39 bytes on the wire instead of ~90 characters.
+ * Text lines (statistics, boot) then travel as text frames.
+ * scripts/navcar_telemetry.py decodes the stream on the host.
+ */
+#define TELEMETRY_BINARY            0U
+
+/* Optional UART report interval (HC-05); binary frames fit five reports a second even at 9600 baud. */
+#if TELEMETRY_BINARY
+#define BLUETOOTH_STATUS_PERIOD_MS  200U
+#else
 #define BLUETOOTH_STATUS_PERIOD_MS  500U
+#endif
 
 #endif /* APP_CONFIG_H */
@@ -2,10 +2,66 @@
 #define BLUETOOTH_H
 
 #include "stm32f4xx_hal.h"
-#include "sensors.h"
+#include "telemetry_frame.h"
 
+typedef struct
+{
+    uint32_t queued_bytes;  /* accepted into the TX ring */
+    uint32_t sent_bytes;    /* finished DMA transfers */
+    uint32_t dropped_bytes; /* overflow or DMA error */
+    uint16_t overflows;     /* sends that found the ring full */
+    uint16_t peak_used;     /* ring high-water mark in bytes */
+} BluetoothTxStats;
+
+typedef struct
+{
+    uint32_t received_bytes;
+    uint32_t frames;        /* idle-line terminated bursts */
+    uint16_t overruns;      /* unread data overwritten by the DMA */
+    uint16_t errors;        /* UART/DMA errors that restarted reception */
+} BluetoothRxStats;
+
+/*
+ * Unread part of the RX ring, valid until the next Bluetooth_ConsumeRx().
+ * Positions run freely; read byte i as data[i & mask]. [start, end) is
+ * unread, and everything before frame_end arrived ahead of an idle line.
+ */
+typedef struct
+{
+    const uint8_t *data;
+    uint32_t mask;
+    uint32_t start;
+    uint32_t end;
+    uint32_t frame_end;
+    uint32_t frame_stamp_cycles; /* CycleCounter_Now() at that idle line */
+} BluetoothRxView;
+
+/*
+ * Sends are non-blocking: the text is copied into the TX ring and USART2
+ * DMA puts it on the wire. On overflow BLUETOOTH_TX_DROP_OLDEST selects
+ * whether the queued backlog or the new message is dropped. With
+ * TELEMETRY_BINARY both go out as COBS frames (telemetry_frame.h).
+ */
 void Bluetooth_Init(UART_HandleTypeDef *huart);
 void Bluetooth_SendText(const char *text);
-void Bluetooth_SendStatus(uint8_t counter, uint8_t scene_id, const SensorSnapshot *snapshot);
+void Bluetooth_SendStatus(const TelemetryStatus *status);
+/* Queues a `uart=tx,...` line with the counters below. */
+void Bluetooth_SendTxStats(void);
+void Bluetooth_GetTxStats(BluetoothTxStats *stats);
+
+/*
+ * Receive path: USART2 RX DMA into a circular ring, single consumer.
+ * Returns 1 when unread bytes are available.
+ */
+uint8_t Bluetooth_GetRxView(BluetoothRxView *view);
+void Bluetooth_ConsumeRx(uint32_t upto);
+void Bluetooth_GetRxStats(BluetoothRxStats *stats);
+/* Queues a `uart=rx,...` line. */
+void Bluetooth_SendRxStats(void);
+
+/* USART2 TX DMA (DMA1 stream 6), RX DMA (DMA1 stream 5) and USART2 interrupt entries. */
+void Bluetooth_OnTxDmaIrq(void);
+void Bluetooth_OnRxDmaIrq(void);
+void Bluetooth_OnUartIrq(void);
 
 #endif /* BLUETOOTH_H */
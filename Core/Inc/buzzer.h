@@ -1,12 +1,31 @@
 #ifndef BUZZER_H
 #define BUZZER_H
 
-#include <stdint.h>
+#include "stm32f4xx_hal.h"
 
-void Buzzer_Init(void);
+typedef struct
+{
+    uint16_t duration_ms;
+    uint16_t tone_hz;      /* 0: silence */
+} BuzzerSegment;
+
+/* htim: a basic timer (TIM10) whose update interrupt calls Buzzer_OnTimerIrq(). */
+void Buzzer_Init(TIM_HandleTypeDef *htim);
 void Buzzer_On(void);
 void Buzzer_Off(void);
-void Buzzer_BeepBlocking(uint16_t duration_ms);
-void Buzzer_BeepPattern(uint8_t count, uint16_t on_ms, uint16_t off_ms);
+
+/*
+ * Non-blocking: the segments are queued and played by the timer interrupt.
+ * A pattern that does not fit into the queue is dropped as a whole.
+ */
+uint8_t Buzzer_Enqueue(const BuzzerSegment *segments, uint8_t count);
+uint8_t Buzzer_Beep(uint16_t duration_ms);
+uint8_t Buzzer_BeepPattern(uint8_t count, uint16_t on_ms, uint16_t off_ms);
+/* Silences the buzzer and drops the queued segments. */
+void Buzzer_Stop(void);
+/* Patterns dropped because the queue was full. */
+uint16_t Buzzer_GetDropped(void);
+
+void Buzzer_OnTimerIrq(void);
 
 #endif /* BUZZER_H */
@@ -0,0 +1,19 @@
+#ifndef CYCLE_COUNTER_H
+#define CYCLE_COUNTER_H
+
+#include "stm32f4xx_hal.h"
+
+/*
+ * DWT cycle counter as a fine timebase. Differences of CycleCounter_Now()
+ * are valid for intervals up to 2^32 cycles (about 51 s at 84 MHz).
+ */
+void CycleCounter_Init(void);
+
+static inline uint32_t CycleCounter_Now(void)
+{
+    return DWT->CYCCNT;
+}
+
+uint32_t CycleCounter_ToMicros(uint32_t cycles);
+
+#endif /* CYCLE_COUNTER_H */
@@ -0,0 +1,38 @@
+#ifndef GPIO_OUT_H
+#define GPIO_OUT_H
+
+#include "stm32f4xx_hal.h"
+
+/*
+ * Shadow output stage. GpioOut_Write() only records the change in per-port
+ * set/reset masks; GpioOut_Flush() applies each dirty port with a single
+ * BSRR write. Flush points: end of Navigation_HandleEvent(), Motor_Stop(),
+ * each LCD nibble, and after init in main(). Ports outside GPIOA..GPIOC are
+ * written immediately.
+ */
+#define GPIO_OUT_PORT_COUNT 3U
+
+typedef struct
+{
+    uint32_t seg_hal_cycles;     /* seven-segment digit, 7 x HAL_GPIO_WritePin */
+    uint32_t seg_shadow_cycles;  /* same digit staged and flushed */
+    uint32_t lcd_hal_cycles;     /* LCD data nibble, 4 x HAL_GPIO_WritePin */
+    uint32_t lcd_shadow_cycles;
+} GpioOutBenchmark;
+
+void GpioOut_Init(void);
+void GpioOut_Write(GPIO_TypeDef *port, uint16_t pins, uint8_t on);
+/* Stages a whole port at once; pins in neither mask keep their staged state. */
+void GpioOut_Stage(GPIO_TypeDef *port, uint16_t set_pins, uint16_t reset_pins);
+void GpioOut_Flush(void);
+
+/* Bypasses the shadow; for interrupt handlers and strobes that must be timed exactly. */
+static inline void GpioOut_WriteNow(GPIO_TypeDef *port, uint16_t pins, uint8_t on)
+{
+    port->BSRR = (on != 0U) ? (uint32_t)pins : ((uint32_t)pins << 16U);
+}
+
+/* Average DWT cycles per update over GPIO_OUT_BENCHMARK_ROUNDS; blanks the display afterwards. */
+void GpioOut_RunBenchmark(GpioOutBenchmark *result);
+
+#endif /* GPIO_OUT_H */
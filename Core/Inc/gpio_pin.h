@@ -0,0 +1,176 @@
+#ifndef GPIO_PIN_H
+#define GPIO_PIN_H
+
+#include "stm32f4xx_hal.h"
+
+#include "gpio_out.h"
+
+/*
+ * Pin groups used by the drivers. Bit i of a value drives the i-th pin of
+ * the group. In the C++ unity build (MDK-ARM/main.cpp) these resolve to the
+ * templates below, so a group costs one shadow update per port with
+ * compile-time masks; a C build stages pin by pin through gpio_out.c.
+ */
+void GpioPin_StageSevenSeg(uint8_t mask);    /* bit 0 = segment A .. bit 6 = G */
+void GpioPin_StageMotorBridge(uint8_t mask); /* bit 0 = IN1 .. bit 3 = IN4 */
+void GpioPin_StageLcdData(uint8_t nibble);   /* bit 0 = D4 .. bit 3 = D7 */
+void GpioPin_ConfigLcdOutputs(void);         /* RS, E, D4..D7 as push-pull outputs */
+
+#ifdef __cplusplus
+/* The unity build includes this inside extern "C"; templates need C++ linkage. */
+extern "C++" {
+namespace GpioPin
+{
+
+constexpr uint32_t MaskIndex(uint32_t mask)
+{
+    return (mask <= 1U) ? 0U : (1U + MaskIndex(mask >> 1U));
+}
+
+/* Spreads a 16-bit pin mask to the 2-bit fields of MODER/PUPDR (01 per pin). */
+constexpr uint32_t SpreadMask(uint32_t mask)
+{
+    return (mask == 0U) ? 0U : (((mask & 1U) != 0U ? 1U : 0U) | (SpreadMask(mask >> 1U) << 2U));
+}
+
+template <uint32_t Base, uint32_t Mask>
+struct Pin
+{
+    static_assert((Mask != 0U) && ((Mask & (Mask - 1U)) == 0U) && (Mask <= 0x8000U),
+                  "a pin is exactly one bit of a 16-bit port");
+
+    static constexpr uint32_t kBase = Base;
+    static constexpr uint32_t kMask = Mask;
+    static constexpr uint32_t kIndex = MaskIndex(Mask);
+};
+
+template <typename... Ps>
+struct PinList;
+
+template <>
+struct PinList<>
+{
+    static constexpr uint32_t MaskOn(uint32_t)
+    {
+        return 0U;
+    }
+    static constexpr uint32_t SetOn(uint32_t, uint32_t, uint32_t)
+    {
+        return 0U;
+    }
+    template <typename Q>
+    static constexpr bool Contains()
+    {
+        return false;
+    }
+    static constexpr bool Distinct()
+    {
+        return true;
+    }
+};
+
+template <typename P, typename... Rest>
+struct PinList<P, Rest...>
+{
+    /* Pins of the list on the port at `base`. */
+    static constexpr uint32_t MaskOn(uint32_t base)
+    {
+        return ((P::kBase == base) ? P::kMask : 0U) | PinList<Rest...>::MaskOn(base);
+    }
+    /* Pins on `base` whose bit in `value` is set; `bit` is the position of P. */
+    static constexpr uint32_t SetOn(uint32_t base, uint32_t value, uint32_t bit)
+    {
+        return (((P::kBase == base) && (((value >> bit) & 1U) != 0U)) ? P::kMask : 0U) |
+               PinList<Rest...>::SetOn(base, value, bit + 1U);
+    }
+    template <typename Q>
+    static constexpr bool Contains()
+    {
+        return ((P::kBase == Q::kBase) && (P::kMask == Q::kMask)) || PinList<Rest...>::template Contains<Q>();
+    }
+    static constexpr bool Distinct()
+    {
+        return !PinList<Rest...>::template Contains<P>() && PinList<Rest...>::Distinct();
+    }
+};
+
+template <typename... Ps>
+struct PinGroup
+{
+    typedef PinList<Ps...> List;
+    static_assert(List::Distinct(), "a pin group lists the same pin twice");
+
+    /* Stages the group in the shadow output stage (gpio_out.c): one update per port. */
+    static void Stage(uint32_t value)
+    {
+        StagePort<GPIOA_BASE>(value);
+        StagePort<GPIOB_BASE>(value);
+        StagePort<GPIOC_BASE>(value);
+    }
+
+    static void ConfigureOutputs()
+    {
+        ConfigurePort<GPIOA_BASE>();
+        ConfigurePort<GPIOB_BASE>();
+        ConfigurePort<GPIOC_BASE>();
+    }
+
+private:
+    template <uint32_t Base>
+    static void StagePort(uint32_t value)
+    {
+        constexpr uint32_t mask = List::MaskOn(Base);
+        if (mask != 0U)
+        {
+            uint32_t set = List::SetOn(Base, value, 0U);
+            GpioOut_Stage(reinterpret_cast<GPIO_TypeDef *>(Base), (uint16_t)set, (uint16_t)(mask & ~set));
+        }
+    }
+
+    template <uint32_t Base>
+    static void ConfigurePort()
+    {
+        constexpr uint32_t mask = List::MaskOn(Base);
+        constexpr uint32_t fields = SpreadMask(mask);
+        if (mask != 0U)
+        {
+            GPIO_TypeDef *port = reinterpret_cast<GPIO_TypeDef *>(Base);
+            uint32_t primask = __get_PRIMASK();
+
+            __disable_irq();
+            port->MODER = (port->MODER & ~(fields * 3U)) | fields;
+            port->OSPEEDR &= ~(fields * 3U);
+            port->PUPDR &= ~(fields * 3U);
+            port->OTYPER &= ~mask;
+            __set_PRIMASK(primask);
+        }
+    }
+};
+
+template <typename G>
+constexpr bool ContainsAnyOf()
+{
+    return false;
+}
+
+template <typename G, typename P, typename... Rest>
+constexpr bool ContainsAnyOf()
+{
+    return G::List::template Contains<P>() || ContainsAnyOf<G, Rest...>();
+}
+
+/* True when the two groups share a pin. */
+template <typename A, typename B>
+struct Overlap;
+
+template <typename A, typename... Ps>
+struct Overlap<A, PinGroup<Ps...> >
+{
+    static constexpr bool value = ContainsAnyOf<A, Ps...>();
+};
+
+} /* namespace GpioPin */
+}
+#endif /* __cplusplus */
+
+#endif /* GPIO_PIN_H */
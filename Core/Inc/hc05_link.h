@@ -0,0 +1,33 @@
+#ifndef HC05_LINK_H
+#define HC05_LINK_H
+
+#include "stm32f4xx_hal.h"
+
+typedef enum
+{
+    HC05_LINK_FIXED = 0,        /* BLUETOOTH_AUTOBAUD 0: stored rate, no probing */
+    HC05_LINK_KEPT,             /* module already answered at the target rate */
+    HC05_LINK_RECONFIGURED,     /* AT+UART accepted and verified after the reset */
+    HC05_LINK_RECONFIG_FAILED,  /* module answers, but not at the target rate */
+    HC05_LINK_NO_ANSWER         /* no AT reply at any rate; stored rate kept */
+} Hc05LinkState;
+
+typedef struct
+{
+    uint32_t baud;
+    uint8_t state;   /* Hc05LinkState */
+    uint8_t probes;  /* AT probes sent */
+} Hc05LinkInfo;
+
+/*
+ * Boot-time link setup; call after ParamStore_Init() and before
+ * Bluetooth_Init(), while USART2 is still only used by blocking calls.
+ * Finds the HC-05 rate with "AT" probes (KEY line held high), moves the
+ * module to BLUETOOTH_BAUD_TARGET with AT+UART, switches USART2 to match and
+ * saves the working rate in PARAM_BT_BAUD.
+ */
+void Hc05Link_Init(UART_HandleTypeDef *huart);
+const Hc05LinkInfo *Hc05Link_GetInfo(void);
+const char *Hc05Link_GetStateName(Hc05LinkState state);
+
+#endif /* HC05_LINK_H */
@@ -0,0 +1,60 @@
+#ifndef HOST_CMD_H
+#define HOST_CMD_H
+
+#include <stdint.h>
+
+#include "navigation.h"
+
+/*
+ * Host commands over the HC-05 link, one per line (CR, LF or ';'; an idle
+ * line also ends a command):
+ *   get [name|index]         report one or all parameters
+ *   set <name|index> <value> change a parameter
+ *   mode scenes|reactive     same as set nav_mode
+ *   plan <scene> [step...]   report, or override the plan of scene 2..5;
+ *                            step = action[:ms[:until[:cm]]], up to
+ *                            NAV_PLAN_MAX_STEPS; `plan <scene> clear`
+ *                            restores the built-in table
+ *   stop / start             halt the car / resume
+ *   save                     write parameters to flash (only while stopped)
+ * Replies are `cmd=...` lines. Writes are validated here and staged; the
+ * navigation context applies them on NAV_EVENT_COMMAND, between decisions.
+ */
+typedef enum
+{
+    HOST_CMD_OP_SET_PARAM = 0,
+    HOST_CMD_OP_STOP,
+    HOST_CMD_OP_START,
+    HOST_CMD_OP_SAVE,
+    HOST_CMD_OP_SET_PLAN   /* param: scene, value: 0 clear, 1 take the staged plan */
+} HostCmdOpType;
+
+typedef struct
+{
+    uint8_t type;   /* HostCmdOpType */
+    uint8_t param;  /* ParamId for HOST_CMD_OP_SET_PARAM, NavSceneId for HOST_CMD_OP_SET_PLAN */
+    uint16_t value;
+} HostCmdOp;
+
+typedef struct
+{
+    uint16_t accepted;
+    uint16_t rejected;       /* unknown, malformed, out of range or too long */
+    uint16_t staging_full;   /* valid writes refused because the stage was full */
+} HostCmdStats;
+
+void HostCmd_Init(void);
+
+/* Parser side: scheduler task or telemetry thread, never the control path. */
+void HostCmd_Poll(void);
+
+/* Navigation side: next staged operation, 0 when none is left. */
+uint8_t HostCmd_PopStaged(HostCmdOp *op);
+/* Latest plan staged for a scene (copied into steps); returns its step count. */
+uint8_t HostCmd_GetStagedPlan(NavSceneId scene, NavPlanStep *steps);
+
+const HostCmdStats *HostCmd_GetStats(void);
+/* Queues a `cmd=stats,...` line. */
+void HostCmd_SendStats(void);
+
+#endif /* HOST_CMD_H */
@@ -1,11 +1,48 @@
 #ifndef INDICATORS_H
 #define INDICATORS_H
 
-#include <stdint.h>
+#include "stm32f4xx_hal.h"
 
-void Indicators_Init(void);
+#define INDICATOR_LED_OBSTACLE  0x01U
+#define INDICATOR_LED_MARK      0x02U
+#define INDICATOR_LED_BOTH      (INDICATOR_LED_OBSTACLE | INDICATOR_LED_MARK)
+
+/* Fault codes: the number of blinks before each pause. */
+#define INDICATOR_FAULT_INIT        1U  /* Error_Handler: peripheral or clock init failed */
+#define INDICATOR_FAULT_HARD        2U
+#define INDICATOR_FAULT_MEMMANAGE   3U
+#define INDICATOR_FAULT_BUS         4U
+#define INDICATOR_FAULT_USAGE       5U
+#define INDICATOR_FAULT_PARAM_SAVE  6U  /* learned parameters could not be written */
+
+typedef struct
+{
+    uint16_t duration_ms;
+    uint8_t leds;          /* INDICATOR_LED_* lit during this step */
+} IndicatorStep;
+
+/* htim: a basic timer ticking every INDICATOR_TICK_MS (TIM11). */
+void Indicators_Init(TIM_HandleTypeDef *htim);
+
+/* Live status; shown whenever no pattern or fault owns the LEDs. */
 void Indicators_SetObstacleLed(uint8_t on);
 void Indicators_SetMarkLed(uint8_t on);
-void Indicators_BlinkBoth(uint8_t count, uint16_t on_ms, uint16_t off_ms);
+
+/* Non-blocking: queued and stepped by the timer interrupt. */
+uint8_t Indicators_Enqueue(const IndicatorStep *steps, uint8_t count);
+uint8_t Indicators_Blink(uint8_t leds, uint8_t count, uint16_t on_ms, uint16_t off_ms);
+
+/*
+ * Overrides queued patterns and repeats the fault code until cleared.
+ * Navigation clears PARAM_SAVE on the next successful save or a host "start".
+ */
+void Indicators_ShowFault(uint8_t code);
+void Indicators_ClearFault(void);
+uint8_t Indicators_GetFault(void);
+
+/* Blinks the fault code forever with interrupts masked, timed by the DWT cycle counter. */
+__NO_RETURN void Indicators_FaultLoop(uint8_t code);
+
+void Indicators_OnTimerIrq(void);
 
 #endif /* INDICATORS_H */
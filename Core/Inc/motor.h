@@ -12,6 +12,7 @@ void Motor_Backward(void);
 void Motor_TurnLeftInPlace(void);
 void Motor_TurnRightInPlace(void);
 void Motor_Stop(void);
+void Motor_GetCommand(int8_t *left_percent, int8_t *right_percent);
 
 void Motor_SetPwmChannels(
     TIM_HandleTypeDef *left_htim,
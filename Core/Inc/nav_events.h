@@ -0,0 +1,67 @@
+#ifndef NAV_EVENTS_H
+#define NAV_EVENTS_H
+
+#include <stdint.h>
+
+typedef enum
+{
+    NAV_EVENT_SAMPLE = 0,           /* sample period elapsed (SysTick) */
+    NAV_EVENT_OBSTACLE_EDGE = 1,    /* a blocked flag changed; arg = NAV_EDGE_* mask */
+    NAV_EVENT_MARK = 2,             /* debounced mark edge */
+    NAV_EVENT_ACTION_DEADLINE = 3,  /* active action reached its duration (SysTick) */
+    NAV_EVENT_COMMAND = 4,          /* host command received; arg = command specific */
+    NAV_EVENT_TYPE_COUNT
+} NavEventType;
+
+#define NAV_EDGE_FRONT  0x01U
+#define NAV_EDGE_LEFT   0x02U
+#define NAV_EDGE_RIGHT  0x04U
+
+typedef struct
+{
+    uint8_t type;          /* NavEventType */
+    uint8_t arg;
+    uint32_t stamp_cycles; /* CycleCounter_Now() when the cause was observed */
+} NavEvent;
+
+/* Event-to-decision latency per event type, in microseconds. */
+typedef struct
+{
+    uint32_t count;
+    uint32_t last_us;
+    uint32_t max_us;
+    uint32_t total_us;
+} NavLatencyStats;
+
+typedef struct
+{
+    uint16_t dropped;          /* posts rejected because the queue was full */
+    uint16_t skipped_samples;  /* samples identical to the last decision, not re-evaluated */
+} NavEventStats;
+
+void NavEvents_Init(void);
+
+/* ISR- and thread-safe. */
+uint8_t NavEvents_Post(NavEventType type, uint8_t arg, uint32_t stamp_cycles);
+uint8_t NavEvents_Pop(NavEvent *event);
+uint8_t NavEvents_HasPending(void);
+
+/* Bare-metal SysTick hook: posts SAMPLE every NAV_SAMPLE_PERIOD_MS and the armed deadline. */
+void NavEvents_OnTick(uint32_t now_ms);
+void NavEvents_ArmDeadline(uint32_t deadline_ms);
+void NavEvents_CancelDeadline(void);
+
+/*
+ * Sleeps in WFI until an interrupt arrives, unless an event is already queued.
+ * With ENABLE_RTOS it blocks the calling thread instead and posts the armed
+ * deadline when the wait times out.
+ */
+void NavEvents_WaitForEvent(void);
+
+void NavEvents_RecordLatency(const NavEvent *event, uint32_t now_cycles);
+void NavEvents_CountSkippedSample(void);
+const NavLatencyStats *NavEvents_GetLatency(NavEventType type);
+const NavEventStats *NavEvents_GetStats(void);
+const char *NavEvents_GetTypeName(NavEventType type);
+
+#endif /* NAV_EVENTS_H */
@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 
+#include "nav_events.h"
+
 typedef enum
 {
     NAV_SCENE_1_CLEAR_FORWARD = 1,
@@ -21,11 +23,84 @@ typedef enum
     NAV_MOTION_TURN_RIGHT = 4
 } NavMotion;
 
+typedef enum
+{
+    NAV_MODE_SCENES = 0,
+    NAV_MODE_REACTIVE = 1
+} NavMode;
+
+typedef enum
+{
+    NAV_ACTION_NONE = 0,
+    NAV_ACTION_PAUSE = 1,
+    NAV_ACTION_REVERSE = 2,
+    NAV_ACTION_BACKOFF = 3,
+    NAV_ACTION_TURN_LEFT_90 = 4,
+    NAV_ACTION_TURN_RIGHT_90 = 5,
+    NAV_ACTION_U_TURN_180 = 6,
+    NAV_ACTION_TURN_ALTERNATE_90 = 7, /* plan step only: left/right alternating per plan */
+    NAV_ACTION_SCAN = 8              /* sweep the front sensor, then face the most open heading */
+} NavActionType;
+
+/*
+ * Termination predicate of a plan step, checked on every sensor sample.
+ * The step duration then acts as a timeout backstop.
+ */
+typedef enum
+{
+    NAV_UNTIL_TIMEOUT = 0,      /* run for the full duration */
+    NAV_UNTIL_FRONT_CLEAR = 1,  /* front distance > until_cm */
+    NAV_UNTIL_LEFT_CLEAR = 2,   /* left distance > until_cm */
+    NAV_UNTIL_RIGHT_CLEAR = 3   /* right distance > until_cm */
+} NavUntil;
+
+/* Built-in plan sets selectable through PARAM_PLAN_SET (A/B strategies). */
+#define NAV_PLAN_SET_COUNT          2U
+
+/* Step duration 0 means "use the tuned default for this action" from the parameter store. */
+#define NAV_STEP_DEFAULT_DURATION   0U
+
+/* until_cm 0 means "use PARAM_CLEAR_DISTANCE_CM". */
+#define NAV_STEP_DEFAULT_CLEARANCE  0U
+
+typedef struct
+{
+    uint8_t action;       /* NavActionType */
+    uint8_t until;        /* NavUntil */
+    uint8_t until_cm;     /* NAV_STEP_DEFAULT_CLEARANCE or explicit distance */
+    uint16_t duration_ms; /* NAV_STEP_DEFAULT_DURATION or explicit length (timeout with a predicate) */
+} NavPlanStep;
+
+/* Dead-reckoned pose; origin and heading 0 are where the run started. */
+typedef struct
+{
+    int32_t x_mm;
+    int32_t y_mm;
+    int16_t heading_ddeg; /* 0.1 degree, counter-clockwise positive, -1800..1799 */
+} NavPose;
+
+typedef struct
+{
+    uint16_t guard_aborts;      /* plans dropped because a guard saw a new obstacle */
+    uint16_t early_exits;       /* actions ended by their termination predicate */
+    uint16_t timeouts;          /* predicate actions that ran into their timeout */
+    uint16_t stalls_no_progress; /* escapes: replanning without net motion */
+    uint16_t stalls_oscillation; /* escapes: repeating scene pattern */
+    uint16_t scans;             /* completed scan sweeps */
+    uint16_t scan_no_opening;   /* sweeps without any heading above the clear distance */
+    uint16_t preempt_drops;     /* queued plan steps dropped to make room for a preemption */
+    uint16_t preempt_refused;   /* preemptions refused because the queue had no room */
+} NavStats;
+
 void Navigation_Init(void);
-void Navigation_Process(void);
+void Navigation_HandleEvent(const NavEvent *event);
 
 uint8_t Navigation_GetCounter(void);
 NavSceneId Navigation_GetCurrentScene(void);
 NavMotion Navigation_GetMotion(void);
+/* Stopped by a host command or at the end of the run. */
+uint8_t Navigation_IsHalted(void);
+const NavStats *Navigation_GetStats(void);
+void Navigation_GetPose(NavPose *pose);
 
 #endif /* NAVIGATION_H */
@@ -0,0 +1,23 @@
+#ifndef OCCUPANCY_GRID_H
+#define OCCUPANCY_GRID_H
+
+#include <stdint.h>
+
+#include "sensors.h"
+
+typedef enum
+{
+    OCC_CELL_UNKNOWN = 0,
+    OCC_CELL_FREE = 1,
+    OCC_CELL_MAYBE_OCCUPIED = 2,
+    OCC_CELL_OCCUPIED = 3
+} OccCell;
+
+void OccGrid_Init(void);
+void OccGrid_Update(const SensorSnapshot *snapshot);
+OccCell OccGrid_GetCellAt(int32_t x_mm, int32_t y_mm);
+
+/* Relative heading: 0 = ahead, +pi/2 = left, -pi/2 = right (pose frame). */
+uint8_t OccGrid_IsHeadingBlocked(float relative_rad, uint16_t range_cm);
+
+#endif /* OCCUPANCY_GRID_H */
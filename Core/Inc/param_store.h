@@ -0,0 +1,49 @@
+#ifndef PARAM_STORE_H
+#define PARAM_STORE_H
+
+#include <stdint.h>
+
+#include "navigation.h"
+
+/*
+ * Runtime-tunable parameters. Defaults come from app_config.h; values can be
+ * changed on site without reflashing and are range-checked on every write.
+ * ParamStore_Save() persists the values and the scene plan overrides to
+ * flash; Init loads the last record.
+ */
+typedef enum
+{
+    PARAM_PLAN_SET = 0,
+    PARAM_NAV_MODE,
+    PARAM_PAUSE_BEFORE_REVERSE_MS,
+    PARAM_REVERSE_LONG_MS,
+    PARAM_BACKOFF_SHORT_MS,
+    PARAM_TURN_LEFT_90_MS,
+    PARAM_TURN_RIGHT_90_MS,
+    PARAM_TURN_180_MS,
+    PARAM_CLEAR_DISTANCE_CM,
+    PARAM_TURN_MIN_PERCENT,
+    PARAM_BT_BAUD,          /* HC-05 link rate in units of 100 baud (hc05_link.c) */
+    PARAM_COUNT
+} ParamId;
+
+void ParamStore_Init(void);
+void ParamStore_RestoreDefaults(void);
+
+uint16_t ParamStore_Get(ParamId id);
+uint8_t ParamStore_Set(ParamId id, uint16_t value);
+/* Range check only, for callers that validate before handing a write on. */
+uint8_t ParamStore_IsValid(ParamId id, uint16_t value);
+const char *ParamStore_GetName(ParamId id);
+
+/* Values changed since the last load/save. Saving may stall the CPU for the sector erase. */
+uint8_t ParamStore_IsDirty(void);
+uint8_t ParamStore_Save(void);
+
+/* Scene plan overrides replace the flash table for one scene (2..5). */
+uint8_t ParamStore_IsScenePlanValid(NavSceneId scene, const NavPlanStep *steps, uint8_t count);
+uint8_t ParamStore_SetScenePlan(NavSceneId scene, const NavPlanStep *steps, uint8_t count);
+void ParamStore_ClearScenePlan(NavSceneId scene);
+const NavPlanStep *ParamStore_GetScenePlan(NavSceneId scene, uint8_t *count);
+
+#endif /* PARAM_STORE_H */
@@ -0,0 +1,16 @@
+#ifndef POSE_H
+#define POSE_H
+
+#include <stdint.h>
+
+#include "navigation.h"
+#include "sensors.h"
+
+void Pose_Init(void);
+void Pose_Update(uint32_t now_ms);
+void Pose_OnMark(void);
+void Pose_OnWallObservation(const SensorSnapshot *snapshot);
+void Pose_Get(NavPose *pose);
+float Pose_GetHeadingRad(void);
+
+#endif /* POSE_H */
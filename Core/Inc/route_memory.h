@@ -0,0 +1,29 @@
+#ifndef ROUTE_MEMORY_H
+#define ROUTE_MEMORY_H
+
+#include <stdint.h>
+
+#include "navigation.h"
+
+typedef enum
+{
+    ROUTE_TURN_NONE = 0,
+    ROUTE_TURN_LEFT = 1,
+    ROUTE_TURN_RIGHT = 2
+} RouteTurn;
+
+typedef struct
+{
+    uint16_t branches;   /* distinct branch points remembered */
+    uint16_t dead_ends;  /* scene 5 events recorded */
+    uint16_t avoidances; /* branch choices steered away from a known dead end */
+} RouteStats;
+
+void RouteMemory_Init(void);
+void RouteMemory_OnMark(uint32_t now_ms);
+RouteTurn RouteMemory_Recommend(uint8_t mark_count, const NavPose *pose, uint32_t now_ms);
+void RouteMemory_OnBranch(uint8_t mark_count, const NavPose *pose, uint32_t now_ms, RouteTurn taken);
+void RouteMemory_OnDeadEnd(uint8_t mark_count, const NavPose *pose);
+const RouteStats *RouteMemory_GetStats(void);
+
+#endif /* ROUTE_MEMORY_H */
@@ -0,0 +1,44 @@
+#ifndef RTOS_APP_H
+#define RTOS_APP_H
+
+#include <stdint.h>
+
+#include "app_config.h"
+
+#if ENABLE_RTOS
+
+/*
+ * CMSIS-RTOS2 (RTX5) build. Sensor acquisition, navigation, UI and telemetry
+ * run as threads in that priority order; slow I/O runs below the control
+ * loop and only ever blocks itself.
+ */
+typedef enum
+{
+    RTOS_THREAD_SENSORS = 0,
+    RTOS_THREAD_CONTROL,
+    RTOS_THREAD_UI,
+    RTOS_THREAD_TELEMETRY,
+    RTOS_THREAD_COUNT
+} RtosThreadId;
+
+typedef struct
+{
+    uint32_t runs;
+    uint16_t load_permille;   /* busy share of the last report window */
+    uint32_t stack_size;
+    uint32_t stack_used_max;  /* high-water mark, needs OS_STACK_WATERMARK */
+} RtosThreadStats;
+
+/* Before any module init: objects created by Navigation_Init need the kernel. */
+uint8_t RtosApp_InitKernel(void);
+
+/* Creates the threads and starts the kernel; returns only if creation failed. */
+void RtosApp_Start(void);
+
+const RtosThreadStats *RtosApp_GetStats(RtosThreadId id);
+const char *RtosApp_GetThreadName(RtosThreadId id);
+uint16_t RtosApp_GetIdlePermille(void);
+
+#endif /* ENABLE_RTOS */
+
+#endif /* RTOS_APP_H */
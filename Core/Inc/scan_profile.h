@@ -0,0 +1,18 @@
+#ifndef SCAN_PROFILE_H
+#define SCAN_PROFILE_H
+
+#include <stdint.h>
+
+void ScanProfile_Begin(float center_rad);
+void ScanProfile_AddSample(float heading_rad, uint16_t front_cm);
+
+/* Heading relative to the scan center, wrapped to [-pi, pi] (+left). */
+float ScanProfile_Offset(float heading_rad);
+
+/*
+ * Offset from the scan center (pose frame, +left) of the most open heading.
+ * Returns 0 when no heading offers at least min_clear_cm.
+ */
+uint8_t ScanProfile_GetBestOffset(uint16_t min_clear_cm, float *offset_rad);
+
+#endif /* SCAN_PROFILE_H */
@@ -0,0 +1,43 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+/*
+ * Cooperative scheduler over a compile-time task table (scheduler.c).
+ * Ids double as table indices; the application runs a task through the
+ * switch in App_RunTask(), so dispatch needs no function pointers.
+ */
+typedef enum
+{
+    SCHED_TASK_NAVIGATION = 0, /* event driven: ready while navigation events are queued */
+    SCHED_TASK_TELEMETRY,
+    SCHED_TASK_LCD,
+    SCHED_TASK_COMMAND,        /* host command parser (host_cmd.c) */
+    SCHED_TASK_COUNT
+} SchedTaskId;
+
+typedef struct
+{
+    uint32_t runs;
+    uint32_t last_exec_us;
+    uint32_t max_exec_us;
+    uint32_t max_jitter_ms;    /* start minus release */
+    uint16_t deadline_misses;  /* finished later than release + deadline */
+    uint16_t skipped_releases; /* whole periods lost to an overrun */
+} SchedTaskStats;
+
+void Scheduler_Init(uint32_t now_ms);
+
+/* Runs the highest-priority ready task, or sleeps until the next interrupt. */
+void Scheduler_RunOnce(void);
+
+const SchedTaskStats *Scheduler_GetStats(SchedTaskId id);
+const char *Scheduler_GetTaskName(SchedTaskId id);
+
+/* Implemented by the application. */
+void App_RunTask(SchedTaskId id);
+/* Queues the module counter lines of the periodic stats report (ENABLE_BLUETOOTH). */
+void App_SendModuleStats(void);
+
+#endif /* SCHEDULER_H */
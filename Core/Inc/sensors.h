@@ -9,16 +9,36 @@ typedef struct
     uint16_t front_adc;
     uint16_t left_adc;
     uint16_t right_adc;
+    uint16_t front_cm;
+    uint16_t left_cm;
+    uint16_t right_cm;
+    int16_t front_closing_cm_s; /* >0 while the front obstacle gets closer */
     uint8_t mark_detected;
     uint8_t front_blocked;
     uint8_t left_blocked;
     uint8_t right_blocked;
 } SensorSnapshot;
 
+/*
+ * Edge times of one mark passing under the OPB704, in DWT cycles. Each edge is
+ * placed where the raw reading crossed MARK_ADC_THRESHOLD, interpolated
+ * between the two samples around the crossing.
+ */
+typedef struct
+{
+    uint32_t leading_cycles;
+    uint32_t trailing_cycles;
+} MarkPass;
+
 void Sensors_Init(ADC_HandleTypeDef *hadc);
+/* Acquires and publishes a snapshot. */
 void Sensors_Update(void);
+/* Takes the last published snapshot as the one Sensors_GetSnapshot() returns. */
+void Sensors_Latch(void);
 const SensorSnapshot *Sensors_GetSnapshot(void);
 
 uint8_t Sensors_ConsumeMarkEdge(void);
+uint8_t Sensors_ConsumeMarkPass(MarkPass *pass);
+uint16_t Sensors_AdcToDistanceCm(uint16_t adc_value);
 
 #endif /* SENSORS_H */
@@ -0,0 +1,24 @@
+#ifndef SPEED_MODEL_H
+#define SPEED_MODEL_H
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint16_t speed_mm_s;  /* last measured ground speed */
+    uint8_t duty_percent; /* mean commanded duty while it was measured */
+    uint8_t from_spacing; /* 1: mark-to-mark interval, 0: single mark width */
+    uint8_t valid;
+} SpeedSample;
+
+void SpeedModel_Init(void);
+
+/* Once per control cycle, after Sensors_Update(): consumes mark passes and fits the model. */
+void SpeedModel_Update(void);
+
+/* Wheel speed predicted for a duty magnitude (0..100). */
+float SpeedModel_WheelSpeedMmS(uint8_t duty_percent);
+
+const SpeedSample *SpeedModel_GetLastSample(void);
+
+#endif /* SPEED_MODEL_H */
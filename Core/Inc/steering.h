@@ -0,0 +1,21 @@
+#ifndef STEERING_H
+#define STEERING_H
+
+#include <stdint.h>
+
+#include "sensors.h"
+
+typedef struct
+{
+    uint8_t left_percent;
+    uint8_t right_percent;
+    int8_t turn_percent; /* >0 steers right, <0 steers left */
+} SteeringCommand;
+
+void Steering_Reset(void);
+uint8_t Steering_ScheduleSpeed(const SensorSnapshot *snapshot);
+void Steering_Compute(const SensorSnapshot *snapshot, uint8_t base_percent, SteeringCommand *command);
+/* The smoothed command has stopped moving toward the last target; the same input would not change it. */
+uint8_t Steering_IsSettled(void);
+
+#endif /* STEERING_H */
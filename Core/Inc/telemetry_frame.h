@@ -0,0 +1,67 @@
+#ifndef TELEMETRY_FRAME_H
+#define TELEMETRY_FRAME_H
+
+#include <stdint.h>
+
+#include "navigation.h"
+#include "sensors.h"
+#include "speed_model.h"
+
+/*
+ * Binary telemetry frame, version 1:
+ *   version (1) | type (1) | sequence (1) | payload | CRC-16 (2, little endian)
+ * The CRC is CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) over everything
+ * before it. The whole frame is COBS-encoded and terminated by one 0x00, so a
+ * receiver resynchronizes at the next zero byte. Multi-byte fields are little
+ * endian. scripts/navcar_telemetry.py is the host-side decoder.
+ */
+#define TELEMETRY_FRAME_VERSION      1U
+#define TELEMETRY_FRAME_TYPE_STATUS  0x01U
+#define TELEMETRY_FRAME_TYPE_TEXT    0x02U
+
+#define TELEMETRY_FRAME_HEADER_BYTES 3U
+#define TELEMETRY_FRAME_CRC_BYTES    2U
+#define TELEMETRY_FRAME_MAX_PAYLOAD  128U
+/* Header, payload and CRC after COBS (one extra byte per 254), plus the delimiter. */
+#define TELEMETRY_FRAME_MAX_ENCODED \
+    (TELEMETRY_FRAME_HEADER_BYTES + TELEMETRY_FRAME_MAX_PAYLOAD + TELEMETRY_FRAME_CRC_BYTES + 2U)
+
+/*
+ * Status payload (32 bytes):
+ *   0 u32 time_ms          14 u8  front_cm        27 i16 heading_ddeg
+ *   4 u8  scene            15 u8  left_cm         29 u16 speed_mm_s
+ *   5 u8  motion           16 u8  right_cm        31 u8  speed duty_percent
+ *   6 u8  counter          17 i16 front_closing_cm_s
+ *   7 u8  flags            19 i32 x_mm
+ *   8 6 bytes: opb, front, left, right ADC, 12 bits each, packed in pairs
+ *              (a[7:0], a[11:8] | b[3:0] << 4, b[11:4])
+ *                          23 i32 y_mm
+ */
+#define TELEMETRY_STATUS_PAYLOAD_BYTES 32U
+
+#define TELEMETRY_FLAG_MARK          0x01U
+#define TELEMETRY_FLAG_FRONT_BLOCKED 0x02U
+#define TELEMETRY_FLAG_LEFT_BLOCKED  0x04U
+#define TELEMETRY_FLAG_RIGHT_BLOCKED 0x08U
+#define TELEMETRY_FLAG_SPEED_VALID   0x10U
+#define TELEMETRY_FLAG_SPEED_SPACING 0x20U
+
+typedef struct
+{
+    uint32_t time_ms;
+    SensorSnapshot snapshot;
+    NavPose pose;
+    SpeedSample speed;
+    uint8_t counter;
+    uint8_t scene;  /* NavSceneId */
+    uint8_t motion; /* NavMotion */
+} TelemetryStatus;
+
+uint16_t TelemetryFrame_Crc16(const uint8_t *data, uint32_t len);
+
+/* Each returns the encoded length including the 0x00 delimiter, or 0 if `out_size` is too small. */
+uint32_t TelemetryFrame_Encode(uint8_t type, const uint8_t *payload, uint32_t len, uint8_t *out, uint32_t out_size);
+uint32_t TelemetryFrame_EncodeStatus(const TelemetryStatus *status, uint8_t *out, uint32_t out_size);
+uint32_t TelemetryFrame_EncodeText(const char *text, uint8_t *out, uint32_t out_size);
+
+#endif /* TELEMETRY_FRAME_H */
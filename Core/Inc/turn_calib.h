@@ -0,0 +1,32 @@
+#ifndef TURN_CALIB_H
+#define TURN_CALIB_H
+
+#include <stdint.h>
+
+#include "navigation.h"
+#include "sensors.h"
+
+typedef struct
+{
+    uint16_t updates; /* duration corrections applied */
+    uint16_t rejects; /* armed turns without a usable wall signature */
+} TurnCalibStats;
+
+void TurnCalib_Init(void);
+
+/* Called for every 90 degree turn that starts, then on each sample while it runs. */
+void TurnCalib_OnTurnStart(NavActionType type, uint32_t duration_ms, const SensorSnapshot *snapshot);
+void TurnCalib_OnTurnSample(const SensorSnapshot *snapshot);
+
+/*
+ * For a turn ended by its predicate, or a timed turn that ran its full
+ * duration; elapsed_ms is how long it turned. Guard-aborted turns are skipped.
+ */
+void TurnCalib_OnTurnComplete(const SensorSnapshot *snapshot, uint32_t elapsed_ms);
+
+/* A predicate turn that ran into its timeout: the view was not one flat wall. */
+void TurnCalib_OnTurnRejected(void);
+
+const TurnCalibStats *TurnCalib_GetStats(void);
+
+#endif /* TURN_CALIB_H */
@@ -1,82 +1,627 @@
 #include "bluetooth.h"
 
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "app_config.h"
+#include "cycle_counter.h"
 #include "pin_map.h"
 
+#if DRIVER_BACKEND_LL
+#include "stm32f4xx_ll_dma.h"
+#include "stm32f4xx_ll_usart.h"
+#endif
+
+/*
+ * Senders copy into a ring that USART2 drains by DMA (DMA1 stream 6,
+ * channel 4), so a send costs a copy instead of the time on the wire.
+ * Indices run freely and are masked on access:
+ *   [tail, send)  handed to the DMA (in flight)
+ *   [send, head)  queued
+ * A transfer covers the queued bytes up to the end of the buffer; its
+ * completion interrupt starts the next one.
+ */
+#define BLUETOOTH_TX_MASK (BLUETOOTH_TX_BUFFER_SIZE - 1U)
+
+#if (BLUETOOTH_TX_BUFFER_SIZE == 0U) || ((BLUETOOTH_TX_BUFFER_SIZE & (BLUETOOTH_TX_BUFFER_SIZE - 1U)) != 0U)
+#error "BLUETOOTH_TX_BUFFER_SIZE must be a power of two"
+#endif
+
+/*
+ * Reception runs without a CPU copy: DMA1 stream 5 (channel 4) writes
+ * USART2 RX into a circular buffer. The half/complete DMA interrupts and
+ * the USART idle-line interrupt publish the write position; an idle line
+ * also closes a frame. The consumer reads [tail, head) in place.
+ */
+#define BLUETOOTH_RX_ACTIVE (ENABLE_BLUETOOTH && BLUETOOTH_RX_ENABLE)
+#define BLUETOOTH_RX_MASK   (BLUETOOTH_RX_BUFFER_SIZE - 1U)
+
+#if (BLUETOOTH_RX_BUFFER_SIZE < 16U) || ((BLUETOOTH_RX_BUFFER_SIZE & (BLUETOOTH_RX_BUFFER_SIZE - 1U)) != 0U)
+#error "BLUETOOTH_RX_BUFFER_SIZE must be a power of two of at least 16"
+#endif
+
+#if DRIVER_BACKEND_LL
+#define BLUETOOTH_TX_DMA        DMA1
+#define BLUETOOTH_TX_DMA_STREAM LL_DMA_STREAM_6
+#define BLUETOOTH_RX_DMA        DMA1
+#define BLUETOOTH_RX_DMA_STREAM LL_DMA_STREAM_5
+#endif
+
 static UART_HandleTypeDef *g_uart = NULL;
 
-#if ENABLE_BLUETOOTH && ENABLE_LCD && LCD_UART2_PA23_SHARED
-static void Bluetooth_ConfigPinsForUart(void)
+#if ENABLE_BLUETOOTH
+static uint8_t g_tx_buffer[BLUETOOTH_TX_BUFFER_SIZE];
+static volatile uint32_t g_tx_head = 0U;
+static volatile uint32_t g_tx_send = 0U;
+static volatile uint32_t g_tx_tail = 0U;
+static volatile uint8_t g_tx_busy = 0U;
+static BluetoothTxStats g_tx_stats;
+#endif
+
+#if BLUETOOTH_RX_ACTIVE
+static uint8_t g_rx_buffer[BLUETOOTH_RX_BUFFER_SIZE];
+static volatile uint32_t g_rx_head = 0U;       /* written by the interrupts */
+static volatile uint32_t g_rx_frame_end = 0U;  /* head at the last idle line */
+static volatile uint32_t g_rx_frame_stamp = 0U;
+static volatile uint32_t g_rx_discard = 0U;    /* bytes before this were lost to a restart */
+static volatile uint8_t g_rx_in_uart_irq = 0U;
+static uint32_t g_rx_tail = 0U;                /* consumer only */
+static BluetoothRxStats g_rx_stats;
+#endif
+
+#if ENABLE_BLUETOOTH
+static uint8_t Bluetooth_StartDma(const uint8_t *data, uint16_t len)
 {
-    GPIO_InitTypeDef gpio = {0};
+#if DRIVER_BACKEND_LL
+    USART_TypeDef *usart = g_uart->Instance;
 
-    gpio.Pin = HC05_UART_TX_Pin | HC05_UART_RX_Pin;
-    gpio.Mode = GPIO_MODE_AF_PP;
-    gpio.Pull = GPIO_PULLUP;
-    gpio.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
-    gpio.Alternate = GPIO_AF7_USART2;
-    HAL_GPIO_Init(GPIOA, &gpio);
+    LL_DMA_DisableStream(BLUETOOTH_TX_DMA, BLUETOOTH_TX_DMA_STREAM);
+    LL_DMA_ClearFlag_TC6(BLUETOOTH_TX_DMA);
+    LL_DMA_ClearFlag_HT6(BLUETOOTH_TX_DMA);
+    LL_DMA_ClearFlag_TE6(BLUETOOTH_TX_DMA);
+    LL_DMA_ClearFlag_DME6(BLUETOOTH_TX_DMA);
+    LL_DMA_ClearFlag_FE6(BLUETOOTH_TX_DMA);
+    LL_DMA_SetMemoryAddress(BLUETOOTH_TX_DMA, BLUETOOTH_TX_DMA_STREAM, (uint32_t)(uintptr_t)data);
+    LL_DMA_SetPeriphAddress(BLUETOOTH_TX_DMA, BLUETOOTH_TX_DMA_STREAM, LL_USART_DMA_GetRegAddr(usart));
+    LL_DMA_SetDataLength(BLUETOOTH_TX_DMA, BLUETOOTH_TX_DMA_STREAM, len);
+    LL_DMA_EnableIT_TC(BLUETOOTH_TX_DMA, BLUETOOTH_TX_DMA_STREAM);
+    LL_DMA_EnableIT_TE(BLUETOOTH_TX_DMA, BLUETOOTH_TX_DMA_STREAM);
+    LL_USART_ClearFlag_TC(usart);
+    LL_USART_EnableDMAReq_TX(usart);
+    LL_DMA_EnableStream(BLUETOOTH_TX_DMA, BLUETOOTH_TX_DMA_STREAM);
+    return 1U;
+#else
+    return (HAL_UART_Transmit_DMA(g_uart, (uint8_t *)data, len) == HAL_OK) ? 1U : 0U;
+#endif
+}
+
+/* Starts the next transfer if the DMA is idle. Call with interrupts masked. */
+static void Bluetooth_KickLocked(void)
+{
+    uint32_t offset;
+    uint32_t len;
+
+    if ((g_tx_busy != 0U) || (g_tx_send == g_tx_head))
+    {
+        return;
+    }
+
+    offset = g_tx_send & BLUETOOTH_TX_MASK;
+    len = g_tx_head - g_tx_send;
+    if (len > (BLUETOOTH_TX_BUFFER_SIZE - offset))
+    {
+        len = BLUETOOTH_TX_BUFFER_SIZE - offset;
+    }
+
+    if (Bluetooth_StartDma(&g_tx_buffer[offset], (uint16_t)len) != 0U)
+    {
+        g_tx_busy = 1U;
+        g_tx_send += len;
+    }
+}
+
+/* Completion of the transfer in flight, from the DMA or UART interrupt. */
+static void Bluetooth_OnTxDone(uint8_t ok)
+{
+    if (g_tx_busy == 0U)
+    {
+        return;
+    }
+
+    if (ok != 0U)
+    {
+        g_tx_stats.sent_bytes += g_tx_send - g_tx_tail;
+    }
+    else
+    {
+        g_tx_stats.dropped_bytes += g_tx_send - g_tx_tail;
+    }
+    g_tx_tail = g_tx_send;
+    g_tx_busy = 0U;
+    Bluetooth_KickLocked();
+}
+
+static void Bluetooth_Enqueue(const uint8_t *data, uint32_t len)
+{
+    uint32_t primask;
+    uint32_t free_bytes;
+    uint32_t offset;
+    uint32_t first;
+    uint32_t used;
+
+    if ((g_uart == NULL) || (len == 0U))
+    {
+        return;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    free_bytes = BLUETOOTH_TX_BUFFER_SIZE - (g_tx_head - g_tx_tail);
+    if (len > free_bytes)
+    {
+        ++g_tx_stats.overflows;
+#if BLUETOOTH_TX_DROP_OLDEST
+        /* Only the queued backlog can go; the transfer in flight finishes. */
+        g_tx_stats.dropped_bytes += g_tx_head - g_tx_send;
+        g_tx_head = g_tx_send;
+        free_bytes = BLUETOOTH_TX_BUFFER_SIZE - (g_tx_head - g_tx_tail);
+#endif
+        if (len > free_bytes)
+        {
+            g_tx_stats.dropped_bytes += len;
+            __set_PRIMASK(primask);
+            return;
+        }
+    }
+
+    offset = g_tx_head & BLUETOOTH_TX_MASK;
+    first = BLUETOOTH_TX_BUFFER_SIZE - offset;
+    if (first > len)
+    {
+        first = len;
+    }
+    memcpy(&g_tx_buffer[offset], data, first);
+    memcpy(&g_tx_buffer[0], &data[first], len - first);
+    g_tx_head += len;
+    g_tx_stats.queued_bytes += len;
+
+    used = g_tx_head - g_tx_tail;
+    if (used > g_tx_stats.peak_used)
+    {
+        g_tx_stats.peak_used = (uint16_t)used;
+    }
+
+    Bluetooth_KickLocked();
+    __set_PRIMASK(primask);
+}
+#endif
+
+#if BLUETOOTH_RX_ACTIVE
+/* `pos`: DMA write offset (buffer size minus NDTR); `idle`: an idle line ended a frame. */
+static void Bluetooth_OnRxPosition(uint32_t pos, uint8_t idle)
+{
+    uint32_t delta = (pos - g_rx_head) & BLUETOOTH_RX_MASK;
+
+    g_rx_head += delta;
+    g_rx_stats.received_bytes += delta;
+    if ((idle != 0U) && (g_rx_head != g_rx_frame_end))
+    {
+        g_rx_frame_end = g_rx_head;
+        g_rx_frame_stamp = CycleCounter_Now();
+        ++g_rx_stats.frames;
+    }
+}
+
+static void Bluetooth_StartRx(void)
+{
+#if DRIVER_BACKEND_LL
+    USART_TypeDef *usart = g_uart->Instance;
+
+    LL_DMA_DisableStream(BLUETOOTH_RX_DMA, BLUETOOTH_RX_DMA_STREAM);
+    LL_DMA_ClearFlag_TC5(BLUETOOTH_RX_DMA);
+    LL_DMA_ClearFlag_HT5(BLUETOOTH_RX_DMA);
+    LL_DMA_ClearFlag_TE5(BLUETOOTH_RX_DMA);
+    LL_DMA_ClearFlag_DME5(BLUETOOTH_RX_DMA);
+    LL_DMA_ClearFlag_FE5(BLUETOOTH_RX_DMA);
+    LL_DMA_SetMemoryAddress(BLUETOOTH_RX_DMA, BLUETOOTH_RX_DMA_STREAM, (uint32_t)(uintptr_t)g_rx_buffer);
+    LL_DMA_SetPeriphAddress(BLUETOOTH_RX_DMA, BLUETOOTH_RX_DMA_STREAM, LL_USART_DMA_GetRegAddr(usart));
+    LL_DMA_SetDataLength(BLUETOOTH_RX_DMA, BLUETOOTH_RX_DMA_STREAM, BLUETOOTH_RX_BUFFER_SIZE);
+    LL_DMA_EnableIT_HT(BLUETOOTH_RX_DMA, BLUETOOTH_RX_DMA_STREAM);
+    LL_DMA_EnableIT_TC(BLUETOOTH_RX_DMA, BLUETOOTH_RX_DMA_STREAM);
+    LL_DMA_EnableIT_TE(BLUETOOTH_RX_DMA, BLUETOOTH_RX_DMA_STREAM);
+    LL_USART_ClearFlag_IDLE(usart);
+    LL_USART_EnableDMAReq_RX(usart);
+    LL_USART_EnableIT_IDLE(usart);
+    LL_USART_EnableIT_ERROR(usart);
+    LL_DMA_EnableStream(BLUETOOTH_RX_DMA, BLUETOOTH_RX_DMA_STREAM);
+#else
+    /* Circular DMA (HAL_UART_MspInit): reports half, complete and idle positions. */
+    (void)HAL_UARTEx_ReceiveToIdle_DMA(g_uart, g_rx_buffer, BLUETOOTH_RX_BUFFER_SIZE);
+#endif
+}
+
+/*
+ * A restart begins at offset 0 again: close the frame, skip the rest of the
+ * lap and let the consumer drop what it had not read yet.
+ */
+static void Bluetooth_RestartRx(void)
+{
+    uint32_t lap = (g_rx_head + BLUETOOTH_RX_MASK) & ~(uint32_t)BLUETOOTH_RX_MASK;
+
+    ++g_rx_stats.errors;
+    g_rx_head = lap;
+    g_rx_frame_end = lap;
+    g_rx_discard = lap;
+    Bluetooth_StartRx();
 }
 #endif
 
 void Bluetooth_Init(UART_HandleTypeDef *huart)
 {
     g_uart = huart;
+#if ENABLE_BLUETOOTH
+    g_tx_head = 0U;
+    g_tx_send = 0U;
+    g_tx_tail = 0U;
+    g_tx_busy = 0U;
+    memset(&g_tx_stats, 0, sizeof(g_tx_stats));
+#endif
+#if BLUETOOTH_RX_ACTIVE
+    g_rx_head = 0U;
+    g_rx_frame_end = 0U;
+    g_rx_discard = 0U;
+    g_rx_tail = 0U;
+    memset(&g_rx_stats, 0, sizeof(g_rx_stats));
+    if (huart != NULL)
+    {
+        Bluetooth_StartRx();
+    }
+#endif
 }
 
 void Bluetooth_SendText(const char *text)
 {
 #if ENABLE_BLUETOOTH
-    if ((g_uart == NULL) || (text == NULL))
+#if TELEMETRY_BINARY
+    uint8_t frame[TELEMETRY_FRAME_MAX_ENCODED];
+#endif
+
+    if (text == NULL)
     {
         return;
     }
 
-#if ENABLE_LCD && LCD_UART2_PA23_SHARED
-    Bluetooth_ConfigPinsForUart();
+#if TELEMETRY_BINARY
+    Bluetooth_Enqueue(frame, TelemetryFrame_EncodeText(text, frame, sizeof(frame)));
+#else
+    Bluetooth_Enqueue((const uint8_t *)text, (uint32_t)strlen(text));
 #endif
-    (void)HAL_UART_Transmit(g_uart, (uint8_t *)text, (uint16_t)strlen(text), 100U);
 #else
     (void)text;
 #endif
 }
 
-void Bluetooth_SendStatus(uint8_t counter, uint8_t scene_id, const SensorSnapshot *snapshot)
+void Bluetooth_SendStatus(const TelemetryStatus *status)
 {
-#if ENABLE_BLUETOOTH
+#if ENABLE_BLUETOOTH && TELEMETRY_BINARY
+    uint8_t frame[TELEMETRY_FRAME_MAX_ENCODED];
+
+    if ((g_uart == NULL) || (status == NULL))
+    {
+        return;
+    }
+
+    Bluetooth_Enqueue(frame, TelemetryFrame_EncodeStatus(status, frame, sizeof(frame)));
+#elif ENABLE_BLUETOOTH
     char msg[128];
     int len;
 
-    if ((g_uart == NULL) || (snapshot == NULL))
+    if ((g_uart == NULL) || (status == NULL))
     {
         return;
     }
 
-#if ENABLE_LCD && LCD_UART2_PA23_SHARED
-    Bluetooth_ConfigPinsForUart();
-#endif
-
     len = snprintf(
         msg,
         sizeof(msg),
-        "scene=%u,cnt=%u,opb=%u,f=%u,l=%u,r=%u\r\n",
-        (unsigned int)scene_id,
-        (unsigned int)counter,
-        (unsigned int)snapshot->opb704_adc,
-        (unsigned int)snapshot->front_adc,
-        (unsigned int)snapshot->left_adc,
-        (unsigned int)snapshot->right_adc);
+        "scene=%u,cnt=%u,opb=%u,f=%u,l=%u,r=%u,x=%ld,y=%ld,h=%d,v=%u,vd=%u\r\n",
+        (unsigned int)status->scene,
+        (unsigned int)status->counter,
+        (unsigned int)status->snapshot.opb704_adc,
+        (unsigned int)status->snapshot.front_adc,
+        (unsigned int)status->snapshot.left_adc,
+        (unsigned int)status->snapshot.right_adc,
+        (long)status->pose.x_mm,
+        (long)status->pose.y_mm,
+        (int)status->pose.heading_ddeg,
+        (unsigned int)status->speed.speed_mm_s,
+        (unsigned int)status->speed.duty_percent);
+
+    if ((len > 0) && ((size_t)len < sizeof(msg)))
+    {
+        Bluetooth_Enqueue((const uint8_t *)msg, (uint32_t)len);
+    }
+#else
+    (void)status;
+#endif
+}
+
+void Bluetooth_SendTxStats(void)
+{
+#if ENABLE_BLUETOOTH
+    BluetoothTxStats stats;
+    char line[96];
+
+    Bluetooth_GetTxStats(&stats);
+    (void)snprintf(
+        line,
+        sizeof(line),
+        "uart=tx,queued=%lu,sent=%lu,drop=%lu,over=%u,peak=%u/%u\r\n",
+        (unsigned long)stats.queued_bytes,
+        (unsigned long)stats.sent_bytes,
+        (unsigned long)stats.dropped_bytes,
+        (unsigned int)stats.overflows,
+        (unsigned int)stats.peak_used,
+        (unsigned int)BLUETOOTH_TX_BUFFER_SIZE);
+    Bluetooth_SendText(line);
+#endif
+}
 
-    if (len > 0)
+void Bluetooth_GetTxStats(BluetoothTxStats *stats)
+{
+#if ENABLE_BLUETOOTH
+    uint32_t primask;
+
+    if (stats == NULL)
     {
-        (void)HAL_UART_Transmit(g_uart, (uint8_t *)msg, (uint16_t)len, 100U);
+        return;
     }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    *stats = g_tx_stats;
+    __set_PRIMASK(primask);
 #else
-    (void)counter;
-    (void)scene_id;
-    (void)snapshot;
+    if (stats != NULL)
+    {
+        memset(stats, 0, sizeof(*stats));
+    }
 #endif
 }
+
+uint8_t Bluetooth_GetRxView(BluetoothRxView *view)
+{
+#if BLUETOOTH_RX_ACTIVE
+    uint32_t head;
+    uint32_t discard;
+
+    if (view == NULL)
+    {
+        return 0U;
+    }
+
+    head = g_rx_head;
+    discard = g_rx_discard;
+    if ((int32_t)(discard - g_rx_tail) > 0)
+    {
+        g_rx_tail = discard;
+    }
+    if ((head - g_rx_tail) > BLUETOOTH_RX_BUFFER_SIZE)
+    {
+        /* Lapped by the DMA: what is left is the tail of a newer frame. */
+        ++g_rx_stats.overruns;
+        g_rx_tail = head;
+    }
+
+    view->data = g_rx_buffer;
+    view->mask = BLUETOOTH_RX_MASK;
+    view->start = g_rx_tail;
+    view->end = head;
+    view->frame_end = g_rx_frame_end;
+    view->frame_stamp_cycles = g_rx_frame_stamp;
+    return (uint8_t)(head != g_rx_tail);
+#else
+    if (view != NULL)
+    {
+        memset(view, 0, sizeof(*view));
+    }
+    return 0U;
+#endif
+}
+
+void Bluetooth_ConsumeRx(uint32_t upto)
+{
+#if BLUETOOTH_RX_ACTIVE
+    if (((int32_t)(upto - g_rx_tail) > 0) && ((int32_t)(g_rx_head - upto) >= 0))
+    {
+        g_rx_tail = upto;
+    }
+#else
+    (void)upto;
+#endif
+}
+
+void Bluetooth_GetRxStats(BluetoothRxStats *stats)
+{
+#if BLUETOOTH_RX_ACTIVE
+    uint32_t primask;
+
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    *stats = g_rx_stats;
+    __set_PRIMASK(primask);
+#else
+    if (stats != NULL)
+    {
+        memset(stats, 0, sizeof(*stats));
+    }
+#endif
+}
+
+void Bluetooth_SendRxStats(void)
+{
+#if BLUETOOTH_RX_ACTIVE
+    BluetoothRxStats stats;
+    char line[80];
+
+    Bluetooth_GetRxStats(&stats);
+    (void)snprintf(
+        line,
+        sizeof(line),
+        "uart=rx,bytes=%lu,frames=%lu,over=%u,err=%u\r\n",
+        (unsigned long)stats.received_bytes,
+        (unsigned long)stats.frames,
+        (unsigned int)stats.overruns,
+        (unsigned int)stats.errors);
+    Bluetooth_SendText(line);
+#endif
+}
+
+void Bluetooth_OnTxDmaIrq(void)
+{
+#if ENABLE_BLUETOOTH
+    if (g_uart == NULL)
+    {
+        return;
+    }
+#if DRIVER_BACKEND_LL
+    if (LL_DMA_IsActiveFlag_TE6(BLUETOOTH_TX_DMA) != 0U)
+    {
+        LL_DMA_ClearFlag_TE6(BLUETOOTH_TX_DMA);
+        LL_DMA_ClearFlag_TC6(BLUETOOTH_TX_DMA);
+        LL_USART_DisableDMAReq_TX(g_uart->Instance);
+        Bluetooth_OnTxDone(0U);
+    }
+    else if (LL_DMA_IsActiveFlag_TC6(BLUETOOTH_TX_DMA) != 0U)
+    {
+        LL_DMA_ClearFlag_TC6(BLUETOOTH_TX_DMA);
+        LL_USART_DisableDMAReq_TX(g_uart->Instance);
+        Bluetooth_OnTxDone(1U);
+    }
+#else
+    HAL_DMA_IRQHandler(g_uart->hdmatx);
+#endif
+#endif
+}
+
+void Bluetooth_OnRxDmaIrq(void)
+{
+#if BLUETOOTH_RX_ACTIVE
+    if (g_uart == NULL)
+    {
+        return;
+    }
+#if DRIVER_BACKEND_LL
+    if (LL_DMA_IsActiveFlag_TE5(BLUETOOTH_RX_DMA) != 0U)
+    {
+        /* The stream disabled itself. */
+        LL_DMA_ClearFlag_TE5(BLUETOOTH_RX_DMA);
+        Bluetooth_RestartRx();
+        return;
+    }
+    if (LL_DMA_IsActiveFlag_HT5(BLUETOOTH_RX_DMA) != 0U)
+    {
+        LL_DMA_ClearFlag_HT5(BLUETOOTH_RX_DMA);
+    }
+    if (LL_DMA_IsActiveFlag_TC5(BLUETOOTH_RX_DMA) != 0U)
+    {
+        LL_DMA_ClearFlag_TC5(BLUETOOTH_RX_DMA);
+    }
+    Bluetooth_OnRxPosition(BLUETOOTH_RX_BUFFER_SIZE - LL_DMA_GetDataLength(BLUETOOTH_RX_DMA, BLUETOOTH_RX_DMA_STREAM), 0U);
+#else
+    HAL_DMA_IRQHandler(g_uart->hdmarx);
+#endif
+#endif
+}
+
+void Bluetooth_OnUartIrq(void)
+{
+#if BLUETOOTH_RX_ACTIVE && DRIVER_BACKEND_LL
+    USART_TypeDef *usart;
+    uint32_t sr;
+
+    if (g_uart == NULL)
+    {
+        return;
+    }
+
+    usart = g_uart->Instance;
+    /*
+     * One SR then DR read clears IDLE and ORE/NE/FE together; the DMA has
+     * taken the data already. Errors are counted, the stream keeps running.
+     */
+    sr = usart->SR;
+    if ((sr & (USART_SR_IDLE | USART_SR_ORE | USART_SR_NE | USART_SR_FE)) == 0U)
+    {
+        return;
+    }
+    LL_USART_ClearFlag_IDLE(usart);
+    if ((sr & (USART_SR_ORE | USART_SR_NE | USART_SR_FE)) != 0U)
+    {
+        ++g_rx_stats.errors;
+    }
+    Bluetooth_OnRxPosition(BLUETOOTH_RX_BUFFER_SIZE - LL_DMA_GetDataLength(BLUETOOTH_RX_DMA, BLUETOOTH_RX_DMA_STREAM),
+                           (uint8_t)((sr & USART_SR_IDLE) != 0U));
+#elif ENABLE_BLUETOOTH && !DRIVER_BACKEND_LL
+    /* The HAL finishes a DMA transmit on TC and reports idle-line receive events. */
+    if (g_uart != NULL)
+    {
+#if BLUETOOTH_RX_ACTIVE
+        g_rx_in_uart_irq = 1U;
+        HAL_UART_IRQHandler(g_uart);
+        g_rx_in_uart_irq = 0U;
+#else
+        HAL_UART_IRQHandler(g_uart);
+#endif
+    }
+#endif
+}
+
+#if ENABLE_BLUETOOTH && !DRIVER_BACKEND_LL
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (huart == g_uart)
+    {
+        Bluetooth_OnTxDone(1U);
+    }
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    if (huart != g_uart)
+    {
+        return;
+    }
+
+    /* A DMA error ends the transmit; drop that chunk and go on with the rest. */
+    if (huart->gState == HAL_UART_STATE_READY)
+    {
+        Bluetooth_OnTxDone(0U);
+    }
+#if BLUETOOTH_RX_ACTIVE
+    /* Overrun, noise or framing errors abort the receive DMA. */
+    if (huart->RxState == HAL_UART_STATE_READY)
+    {
+        Bluetooth_RestartRx();
+    }
+#endif
+}
+#endif
+
+#if BLUETOOTH_RX_ACTIVE && !DRIVER_BACKEND_LL
+/* Half and full buffer come from the DMA interrupt, an idle line from the USART interrupt. */
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+    if (huart == g_uart)
+    {
+        Bluetooth_OnRxPosition(Size, g_rx_in_uart_irq);
+    }
+}
+#endif
@@ -1,41 +1,234 @@
 #include "buzzer.h"
 
+#include <stddef.h>
+
+#include "app_config.h"
+#include "gpio_out.h"
 #include "pin_map.h"
-#include "stm32f4xx_hal.h"
 
-void Buzzer_Init(void)
+#if DRIVER_BACKEND_LL
+#include "stm32f4xx_ll_gpio.h"
+#endif
+
+/*
+ * The timer counts microseconds (main.c sets TIM10 to 1 MHz) and its reload
+ * is re-armed per tick: half a tone period while a passive buzzer sounds,
+ * otherwise up to BUZZER_MAX_TICK_US, so a plain beep costs a few interrupts.
+ * The timer stops when the queue runs empty.
+ */
+
+#define BUZZER_QUEUE_MASK  (BUZZER_QUEUE_CAPACITY - 1U)
+#define BUZZER_MAX_TICK_US 50000U
+
+#if (BUZZER_QUEUE_CAPACITY == 0U) || ((BUZZER_QUEUE_CAPACITY & (BUZZER_QUEUE_CAPACITY - 1U)) != 0U)
+#error "BUZZER_QUEUE_CAPACITY must be a power of two"
+#endif
+
+static TIM_HandleTypeDef *g_buzzer_tim = NULL;
+
+static BuzzerSegment g_buzzer_queue[BUZZER_QUEUE_CAPACITY];
+static volatile uint8_t g_buzzer_head = 0U;
+static volatile uint8_t g_buzzer_count = 0U;
+static volatile uint8_t g_buzzer_playing = 0U;
+static uint16_t g_buzzer_dropped = 0U;
+
+static uint32_t g_buzzer_remaining_us = 0U;
+static uint32_t g_buzzer_tick_us = 0U;
+static uint32_t g_buzzer_half_period_us = 0U;
+static uint8_t g_buzzer_pin_high = 0U;
+
+static void Buzzer_WritePin(uint8_t high)
 {
+    g_buzzer_pin_high = high;
+    GpioOut_WriteNow(BUZZER_GPIO_Port, BUZZER_Pin, high);
+}
+
+static void Buzzer_ArmTick(void)
+{
+    uint32_t tick_us = (g_buzzer_half_period_us != 0U) ? g_buzzer_half_period_us : BUZZER_MAX_TICK_US;
+
+    if (tick_us > g_buzzer_remaining_us)
+    {
+        tick_us = g_buzzer_remaining_us;
+    }
+    g_buzzer_tick_us = tick_us;
+    __HAL_TIM_SET_AUTORELOAD(g_buzzer_tim, tick_us - 1U);
+}
+
+/* Caller holds the queue: interrupt context or PRIMASK set. */
+static uint8_t Buzzer_StartNext(void)
+{
+    while (g_buzzer_count != 0U)
+    {
+        const BuzzerSegment *segment = &g_buzzer_queue[g_buzzer_head];
+
+        g_buzzer_head = (uint8_t)((g_buzzer_head + 1U) & BUZZER_QUEUE_MASK);
+        --g_buzzer_count;
+        if (segment->duration_ms == 0U)
+        {
+            continue;
+        }
+
+        g_buzzer_remaining_us = (uint32_t)segment->duration_ms * 1000U;
+#if BUZZER_DRIVE_TONE
+        g_buzzer_half_period_us = (segment->tone_hz != 0U) ? (500000U / segment->tone_hz) : 0U;
+#else
+        g_buzzer_half_period_us = 0U;
+#endif
+        Buzzer_WritePin((segment->tone_hz != 0U) ? 1U : 0U);
+        Buzzer_ArmTick();
+        g_buzzer_playing = 1U;
+        return 1U;
+    }
+
+    g_buzzer_playing = 0U;
+    Buzzer_WritePin(0U);
+    return 0U;
+}
+
+void Buzzer_Init(TIM_HandleTypeDef *htim)
+{
+    g_buzzer_tim = htim;
+    g_buzzer_head = 0U;
+    g_buzzer_count = 0U;
+    g_buzzer_playing = 0U;
+    g_buzzer_dropped = 0U;
     Buzzer_Off();
 }
 
 void Buzzer_On(void)
 {
+#if DRIVER_BACKEND_LL
+    LL_GPIO_SetOutputPin(BUZZER_GPIO_Port, BUZZER_Pin);
+#else
     HAL_GPIO_WritePin(BUZZER_GPIO_Port, BUZZER_Pin, GPIO_PIN_SET);
+#endif
 }
 
 void Buzzer_Off(void)
 {
+#if DRIVER_BACKEND_LL
+    LL_GPIO_ResetOutputPin(BUZZER_GPIO_Port, BUZZER_Pin);
+#else
     HAL_GPIO_WritePin(BUZZER_GPIO_Port, BUZZER_Pin, GPIO_PIN_RESET);
+#endif
 }
 
-void Buzzer_BeepBlocking(uint16_t duration_ms)
+uint8_t Buzzer_Enqueue(const BuzzerSegment *segments, uint8_t count)
 {
-    Buzzer_On();
-    HAL_Delay(duration_ms);
-    Buzzer_Off();
+    uint32_t primask;
+    uint8_t ok = 0U;
+    uint8_t i;
+
+    if ((g_buzzer_tim == NULL) || (segments == NULL) || (count == 0U))
+    {
+        return 0U;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if ((uint32_t)g_buzzer_count + count <= BUZZER_QUEUE_CAPACITY)
+    {
+        for (i = 0U; i < count; ++i)
+        {
+            g_buzzer_queue[(g_buzzer_head + g_buzzer_count) & BUZZER_QUEUE_MASK] = segments[i];
+            ++g_buzzer_count;
+        }
+
+        if ((g_buzzer_playing == 0U) && (Buzzer_StartNext() != 0U))
+        {
+            __HAL_TIM_SET_COUNTER(g_buzzer_tim, 0U);
+            __HAL_TIM_CLEAR_FLAG(g_buzzer_tim, TIM_FLAG_UPDATE);
+            (void)HAL_TIM_Base_Start_IT(g_buzzer_tim);
+        }
+        ok = 1U;
+    }
+    else
+    {
+        ++g_buzzer_dropped;
+    }
+    __set_PRIMASK(primask);
+
+    return ok;
+}
+
+uint8_t Buzzer_Beep(uint16_t duration_ms)
+{
+    BuzzerSegment segment;
+
+    segment.duration_ms = duration_ms;
+    segment.tone_hz = BUZZER_TONE_HZ;
+    return Buzzer_Enqueue(&segment, 1U);
 }
 
-void Buzzer_BeepPattern(uint8_t count, uint16_t on_ms, uint16_t off_ms)
+uint8_t Buzzer_BeepPattern(uint8_t count, uint16_t on_ms, uint16_t off_ms)
 {
+    BuzzerSegment pattern[BUZZER_QUEUE_CAPACITY];
+    uint8_t n = 0U;
     uint8_t i;
-    for (i = 0U; i < count; ++i)
+
+    for (i = 0U; (i < count) && (n < BUZZER_QUEUE_CAPACITY); ++i)
     {
-        Buzzer_On();
-        HAL_Delay(on_ms);
-        Buzzer_Off();
-        if ((i + 1U) < count)
+        pattern[n].duration_ms = on_ms;
+        pattern[n].tone_hz = BUZZER_TONE_HZ;
+        ++n;
+        if (((i + 1U) < count) && (n < BUZZER_QUEUE_CAPACITY))
         {
-            HAL_Delay(off_ms);
+            pattern[n].duration_ms = off_ms;
+            pattern[n].tone_hz = 0U;
+            ++n;
         }
     }
+
+    return Buzzer_Enqueue(pattern, n);
+}
+
+void Buzzer_Stop(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    g_buzzer_count = 0U;
+    g_buzzer_playing = 0U;
+    if (g_buzzer_tim != NULL)
+    {
+        (void)HAL_TIM_Base_Stop_IT(g_buzzer_tim);
+    }
+    Buzzer_WritePin(0U);
+    __set_PRIMASK(primask);
+}
+
+uint16_t Buzzer_GetDropped(void)
+{
+    return g_buzzer_dropped;
+}
+
+void Buzzer_OnTimerIrq(void)
+{
+    if ((g_buzzer_tim == NULL) || (__HAL_TIM_GET_FLAG(g_buzzer_tim, TIM_FLAG_UPDATE) == RESET))
+    {
+        return;
+    }
+    __HAL_TIM_CLEAR_FLAG(g_buzzer_tim, TIM_FLAG_UPDATE);
+
+    if (g_buzzer_playing == 0U)
+    {
+        return;
+    }
+
+    g_buzzer_remaining_us -= g_buzzer_tick_us;
+    if (g_buzzer_remaining_us == 0U)
+    {
+        if (Buzzer_StartNext() == 0U)
+        {
+            (void)HAL_TIM_Base_Stop_IT(g_buzzer_tim);
+        }
+        return;
+    }
+
+    if (g_buzzer_half_period_us != 0U)
+    {
+        Buzzer_WritePin((uint8_t)(g_buzzer_pin_high == 0U));
+    }
+    Buzzer_ArmTick();
 }
@@ -0,0 +1,19 @@
+#include "cycle_counter.h"
+
+void CycleCounter_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0U;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+uint32_t CycleCounter_ToMicros(uint32_t cycles)
+{
+    uint32_t cycles_per_us = SystemCoreClock / 1000000U;
+
+    if (cycles_per_us == 0U)
+    {
+        return cycles;
+    }
+    return cycles / cycles_per_us;
+}
@@ -0,0 +1,167 @@
+#include "gpio_out.h"
+
+#include <stddef.h>
+
+#include "app_config.h"
+#include "cycle_counter.h"
+#include "pin_map.h"
+
+static volatile uint16_t g_gpio_out_set[GPIO_OUT_PORT_COUNT];
+static volatile uint16_t g_gpio_out_reset[GPIO_OUT_PORT_COUNT];
+static GPIO_TypeDef *const kGpioOutPorts[GPIO_OUT_PORT_COUNT] = {GPIOA, GPIOB, GPIOC};
+
+static uint32_t GpioOut_PortIndex(const GPIO_TypeDef *port)
+{
+    /* AHB1 GPIO ports are 0x400 apart, starting at GPIOA. */
+    return (uint32_t)(((uintptr_t)port - GPIOA_BASE) / (GPIOB_BASE - GPIOA_BASE));
+}
+
+void GpioOut_Init(void)
+{
+    uint8_t i;
+
+    for (i = 0U; i < GPIO_OUT_PORT_COUNT; ++i)
+    {
+        g_gpio_out_set[i] = 0U;
+        g_gpio_out_reset[i] = 0U;
+    }
+}
+
+void GpioOut_Stage(GPIO_TypeDef *port, uint16_t set_pins, uint16_t reset_pins)
+{
+    uint32_t idx = GpioOut_PortIndex(port);
+    uint32_t primask;
+
+    if (idx >= GPIO_OUT_PORT_COUNT)
+    {
+        port->BSRR = (uint32_t)set_pins | ((uint32_t)reset_pins << 16U);
+        return;
+    }
+
+    /* Writers from different threads may share a port. */
+    primask = __get_PRIMASK();
+    __disable_irq();
+    g_gpio_out_set[idx] = (uint16_t)((g_gpio_out_set[idx] & (uint16_t)~reset_pins) | set_pins);
+    g_gpio_out_reset[idx] = (uint16_t)((g_gpio_out_reset[idx] & (uint16_t)~set_pins) | reset_pins);
+    __set_PRIMASK(primask);
+}
+
+void GpioOut_Write(GPIO_TypeDef *port, uint16_t pins, uint8_t on)
+{
+    if (on != 0U)
+    {
+        GpioOut_Stage(port, pins, 0U);
+    }
+    else
+    {
+        GpioOut_Stage(port, 0U, pins);
+    }
+}
+
+void GpioOut_Flush(void)
+{
+    uint32_t primask;
+    uint8_t i;
+
+    for (i = 0U; i < GPIO_OUT_PORT_COUNT; ++i)
+    {
+        uint32_t bsrr;
+
+        primask = __get_PRIMASK();
+        __disable_irq();
+        bsrr = (uint32_t)g_gpio_out_set[i] | ((uint32_t)g_gpio_out_reset[i] << 16U);
+        g_gpio_out_set[i] = 0U;
+        g_gpio_out_reset[i] = 0U;
+        __set_PRIMASK(primask);
+
+        if (bsrr != 0U)
+        {
+            kGpioOutPorts[i]->BSRR = bsrr;
+        }
+    }
+}
+
+#if GPIO_OUT_BENCHMARK
+static GPIO_TypeDef *const kBenchSegPorts[7] =
+{
+    SEG_A_GPIO_Port, SEG_B_GPIO_Port, SEG_C_GPIO_Port, SEG_D_GPIO_Port,
+    SEG_E_GPIO_Port, SEG_F_GPIO_Port, SEG_G_GPIO_Port
+};
+
+static const uint16_t kBenchSegPins[7] =
+{
+    SEG_A_Pin, SEG_B_Pin, SEG_C_Pin, SEG_D_Pin, SEG_E_Pin, SEG_F_Pin, SEG_G_Pin
+};
+
+static GPIO_TypeDef *const kBenchLcdPorts[4] =
+{
+    LCD_D4_GPIO_Port, LCD_D5_GPIO_Port, LCD_D6_GPIO_Port, LCD_D7_GPIO_Port
+};
+
+static const uint16_t kBenchLcdPins[4] =
+{
+    LCD_D4_Pin, LCD_D5_Pin, LCD_D6_Pin, LCD_D7_Pin
+};
+
+/* Times `count` pin writes of pattern `mask`, either through HAL or staged and flushed. */
+static uint32_t GpioOut_TimeWrites(GPIO_TypeDef *const *ports, const uint16_t *pins, uint8_t count, uint8_t use_shadow)
+{
+    uint32_t total = 0U;
+    uint32_t round;
+    uint8_t i;
+
+    for (round = 0U; round < GPIO_OUT_BENCHMARK_ROUNDS; ++round)
+    {
+        uint8_t mask = (uint8_t)(round * 37U);
+        uint32_t primask = __get_PRIMASK();
+        uint32_t start;
+
+        __disable_irq();
+        start = CycleCounter_Now();
+        if (use_shadow != 0U)
+        {
+            for (i = 0U; i < count; ++i)
+            {
+                GpioOut_Write(ports[i], pins[i], (uint8_t)((mask >> i) & 1U));
+            }
+            GpioOut_Flush();
+        }
+        else
+        {
+            for (i = 0U; i < count; ++i)
+            {
+                HAL_GPIO_WritePin(ports[i], pins[i], (((mask >> i) & 1U) != 0U) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+            }
+        }
+        total += CycleCounter_Now() - start;
+        __set_PRIMASK(primask);
+    }
+
+    return total / GPIO_OUT_BENCHMARK_ROUNDS;
+}
+#endif
+
+void GpioOut_RunBenchmark(GpioOutBenchmark *result)
+{
+#if GPIO_OUT_BENCHMARK
+    uint8_t i;
+
+    if (result == NULL)
+    {
+        return;
+    }
+
+    result->seg_hal_cycles = GpioOut_TimeWrites(kBenchSegPorts, kBenchSegPins, 7U, 0U);
+    result->seg_shadow_cycles = GpioOut_TimeWrites(kBenchSegPorts, kBenchSegPins, 7U, 1U);
+    result->lcd_hal_cycles = GpioOut_TimeWrites(kBenchLcdPorts, kBenchLcdPins, 4U, 0U);
+    result->lcd_shadow_cycles = GpioOut_TimeWrites(kBenchLcdPorts, kBenchLcdPins, 4U, 1U);
+
+    for (i = 0U; i < 7U; ++i)
+    {
+        GpioOut_Write(kBenchSegPorts[i], kBenchSegPins[i], 0U);
+    }
+    GpioOut_Flush();
+#else
+    (void)result;
+#endif
+}
@@ -0,0 +1,182 @@
+#include "gpio_pin.h"
+
+#include "app_config.h"
+#include "pin_map.h"
+
+#ifdef __cplusplus
+
+extern "C++" {
+namespace GpioPin
+{
+
+typedef PinGroup<
+    Pin<SEG_A_GPIO_Base, SEG_A_Pin>,
+    Pin<SEG_B_GPIO_Base, SEG_B_Pin>,
+    Pin<SEG_C_GPIO_Base, SEG_C_Pin>,
+    Pin<SEG_D_GPIO_Base, SEG_D_Pin>,
+    Pin<SEG_E_GPIO_Base, SEG_E_Pin>,
+    Pin<SEG_F_GPIO_Base, SEG_F_Pin>,
+    Pin<SEG_G_GPIO_Base, SEG_G_Pin> > SevenSegPins;
+
+typedef PinGroup<
+    Pin<MOTOR_IN1_GPIO_Base, MOTOR_IN1_Pin>,
+    Pin<MOTOR_IN2_GPIO_Base, MOTOR_IN2_Pin>,
+    Pin<MOTOR_IN3_GPIO_Base, MOTOR_IN3_Pin>,
+    Pin<MOTOR_IN4_GPIO_Base, MOTOR_IN4_Pin> > MotorBridgePins;
+
+typedef PinGroup<
+    Pin<MOTOR_ENA_GPIO_Base, MOTOR_ENA_Pin>,
+    Pin<MOTOR_ENB_GPIO_Base, MOTOR_ENB_Pin> > MotorEnablePins;
+
+typedef PinGroup<
+    Pin<LCD_D4_GPIO_Base, LCD_D4_Pin>,
+    Pin<LCD_D5_GPIO_Base, LCD_D5_Pin>,
+    Pin<LCD_D6_GPIO_Base, LCD_D6_Pin>,
+    Pin<LCD_D7_GPIO_Base, LCD_D7_Pin> > LcdDataPins;
+
+typedef PinGroup<
+    Pin<LCD_RS_GPIO_Base, LCD_RS_Pin>,
+    Pin<LCD_E_GPIO_Base, LCD_E_Pin>,
+    Pin<LCD_D4_GPIO_Base, LCD_D4_Pin>,
+    Pin<LCD_D5_GPIO_Base, LCD_D5_Pin>,
+    Pin<LCD_D6_GPIO_Base, LCD_D6_Pin>,
+    Pin<LCD_D7_GPIO_Base, LCD_D7_Pin> > LcdPins;
+
+typedef PinGroup<
+    Pin<LED_OBSTACLE_GPIO_Base, LED_OBSTACLE_Pin>,
+    Pin<LED_MARK_GPIO_Base, LED_MARK_Pin>,
+    Pin<BUZZER_GPIO_Base, BUZZER_Pin> > SignalPins;
+
+typedef PinGroup<
+    Pin<OPB704_ADC_GPIO_Base, OPB704_ADC_Pin>,
+    Pin<OBST_FRONT_ADC_GPIO_Base, OBST_FRONT_ADC_Pin>,
+    Pin<OBST_LEFT_ADC_GPIO_Base, OBST_LEFT_ADC_Pin>,
+    Pin<OBST_RIGHT_ADC_GPIO_Base, OBST_RIGHT_ADC_Pin> > AdcPins;
+
+typedef PinGroup<
+    Pin<HC05_UART_TX_GPIO_Base, HC05_UART_TX_Pin>,
+    Pin<HC05_UART_RX_GPIO_Base, HC05_UART_RX_Pin> > Usart2Pins;
+
+typedef PinGroup<Pin<HC05_KEY_GPIO_Base, HC05_KEY_Pin> > Hc05KeyPins;
+
+/* Pin conflicts are build errors. Deliberate sharing must be switched on in pin_map.h. */
+static_assert(!Overlap<MotorBridgePins, SevenSegPins>::value && !Overlap<MotorEnablePins, SevenSegPins>::value &&
+              !Overlap<MotorBridgePins, MotorEnablePins>::value,
+              "motor pins overlap each other or the seven-segment display");
+static_assert(!Overlap<SignalPins, SevenSegPins>::value && !Overlap<SignalPins, MotorBridgePins>::value &&
+              !Overlap<SignalPins, MotorEnablePins>::value,
+              "an LED or the buzzer overlaps a motor or display pin");
+static_assert(RED_LED_SHARED_WITH_OPB704 || !Overlap<SignalPins, AdcPins>::value,
+              "an LED or the buzzer overlaps a sensor ADC input");
+static_assert(!ENABLE_LCD || (!Overlap<LcdPins, MotorBridgePins>::value && !Overlap<LcdPins, MotorEnablePins>::value),
+              "LCD pins overlap the motor driver");
+static_assert(!ENABLE_LCD || (!Overlap<LcdPins, SevenSegPins>::value && !Overlap<LcdPins, SignalPins>::value &&
+                              !Overlap<LcdPins, AdcPins>::value),
+              "LCD pins overlap the display, LEDs, buzzer or sensors");
+static_assert(!ENABLE_LCD || !ENABLE_BLUETOOTH || !Overlap<LcdPins, Usart2Pins>::value,
+              "LCD pins overlap USART2 PA2/PA3");
+static_assert(!ENABLE_BLUETOOTH || (!Overlap<Usart2Pins, MotorBridgePins>::value && !Overlap<Usart2Pins, SignalPins>::value &&
+                                    !Overlap<Usart2Pins, AdcPins>::value),
+              "USART2 pins overlap another function");
+static_assert(!ENABLE_BLUETOOTH || !BLUETOOTH_AUTOBAUD ||
+                  (!Overlap<Hc05KeyPins, MotorBridgePins>::value && !Overlap<Hc05KeyPins, MotorEnablePins>::value &&
+                   !Overlap<Hc05KeyPins, SevenSegPins>::value && !Overlap<Hc05KeyPins, SignalPins>::value &&
+                   !Overlap<Hc05KeyPins, AdcPins>::value && !Overlap<Hc05KeyPins, Usart2Pins>::value &&
+                   (!ENABLE_LCD || !Overlap<Hc05KeyPins, LcdPins>::value)),
+              "the HC-05 KEY pin overlaps another function");
+
+} /* namespace GpioPin */
+}
+
+void GpioPin_StageSevenSeg(uint8_t mask)
+{
+    GpioPin::SevenSegPins::Stage(mask);
+}
+
+void GpioPin_StageMotorBridge(uint8_t mask)
+{
+    GpioPin::MotorBridgePins::Stage(mask);
+}
+
+void GpioPin_StageLcdData(uint8_t nibble)
+{
+    GpioPin::LcdDataPins::Stage(nibble);
+}
+
+void GpioPin_ConfigLcdOutputs(void)
+{
+    GpioPin::LcdPins::ConfigureOutputs();
+}
+
+#else /* C build: the same groups as tables, staged pin by pin. */
+
+static GPIO_TypeDef *const kGpioPinSegPorts[7] =
+{
+    SEG_A_GPIO_Port, SEG_B_GPIO_Port, SEG_C_GPIO_Port, SEG_D_GPIO_Port,
+    SEG_E_GPIO_Port, SEG_F_GPIO_Port, SEG_G_GPIO_Port
+};
+static const uint16_t kGpioPinSegPins[7] =
+{
+    SEG_A_Pin, SEG_B_Pin, SEG_C_Pin, SEG_D_Pin, SEG_E_Pin, SEG_F_Pin, SEG_G_Pin
+};
+
+static GPIO_TypeDef *const kGpioPinBridgePorts[4] =
+{
+    MOTOR_IN1_GPIO_Port, MOTOR_IN2_GPIO_Port, MOTOR_IN3_GPIO_Port, MOTOR_IN4_GPIO_Port
+};
+static const uint16_t kGpioPinBridgePins[4] =
+{
+    MOTOR_IN1_Pin, MOTOR_IN2_Pin, MOTOR_IN3_Pin, MOTOR_IN4_Pin
+};
+
+static GPIO_TypeDef *const kGpioPinLcdPorts[6] =
+{
+    LCD_D4_GPIO_Port, LCD_D5_GPIO_Port, LCD_D6_GPIO_Port, LCD_D7_GPIO_Port,
+    LCD_RS_GPIO_Port, LCD_E_GPIO_Port
+};
+static const uint16_t kGpioPinLcdPins[6] =
+{
+    LCD_D4_Pin, LCD_D5_Pin, LCD_D6_Pin, LCD_D7_Pin, LCD_RS_Pin, LCD_E_Pin
+};
+
+static void GpioPin_StageList(GPIO_TypeDef *const *ports, const uint16_t *pins, uint8_t count, uint32_t value)
+{
+    uint8_t i;
+
+    for (i = 0U; i < count; ++i)
+    {
+        GpioOut_Write(ports[i], pins[i], (uint8_t)((value >> i) & 1U));
+    }
+}
+
+void GpioPin_StageSevenSeg(uint8_t mask)
+{
+    GpioPin_StageList(kGpioPinSegPorts, kGpioPinSegPins, 7U, mask);
+}
+
+void GpioPin_StageMotorBridge(uint8_t mask)
+{
+    GpioPin_StageList(kGpioPinBridgePorts, kGpioPinBridgePins, 4U, mask);
+}
+
+void GpioPin_StageLcdData(uint8_t nibble)
+{
+    GpioPin_StageList(kGpioPinLcdPorts, kGpioPinLcdPins, 4U, nibble);
+}
+
+void GpioPin_ConfigLcdOutputs(void)
+{
+    GPIO_InitTypeDef gpio = {0};
+    uint8_t i;
+
+    gpio.Mode = GPIO_MODE_OUTPUT_PP;
+    gpio.Pull = GPIO_NOPULL;
+    gpio.Speed = GPIO_SPEED_FREQ_LOW;
+    for (i = 0U; i < 6U; ++i)
+    {
+        gpio.Pin = kGpioPinLcdPins[i];
+        HAL_GPIO_Init(kGpioPinLcdPorts[i], &gpio);
+    }
+}
+
+#endif /* __cplusplus */
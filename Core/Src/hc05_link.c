@@ -0,0 +1,248 @@
+#include "hc05_link.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "app_config.h"
+#include "param_store.h"
+#include "pin_map.h"
+
+/*
+ * With KEY high after power-up the HC-05 takes AT commands at its current
+ * data rate. AT+UART is stored by the module and applies after AT+RESET;
+ * KEY must be low again by then, or the module boots into the fixed
+ * 38400 baud command mode instead of data mode.
+ */
+static const uint32_t kHc05Bauds[] =
+{
+    9600U, 38400U, 57600U, 115200U, 19200U, 230400U, 460800U
+};
+
+#if (BLUETOOTH_BAUD_TARGET < 9600U) || (BLUETOOTH_BAUD_TARGET > 460800U)
+#error "BLUETOOTH_BAUD_TARGET must be an HC-05 rate between 9600 and 460800"
+#endif
+
+#define HC05_BAUD_COUNT   (sizeof(kHc05Bauds) / sizeof(kHc05Bauds[0]))
+#define HC05_REPLY_BYTES  24U
+
+static Hc05LinkInfo g_hc05_info = {BLUETOOTH_BAUD_DEFAULT, (uint8_t)HC05_LINK_FIXED, 0U};
+
+#if ENABLE_BLUETOOTH
+/* UART_SetConfig() only: after the first init HAL_UART_Init() skips the MSP. */
+static void Hc05Link_SetBaud(UART_HandleTypeDef *huart, uint32_t baud)
+{
+    if (huart->Init.BaudRate == baud)
+    {
+        return;
+    }
+
+    huart->Init.BaudRate = baud;
+    (void)HAL_UART_Init(huart);
+}
+#endif
+
+#if ENABLE_BLUETOOTH && BLUETOOTH_AUTOBAUD
+static void Hc05Link_SetKey(uint8_t high)
+{
+    HAL_GPIO_WritePin(HC05_KEY_GPIO_Port, HC05_KEY_Pin, (high != 0U) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+}
+
+static void Hc05Link_InitKeyPin(void)
+{
+    GPIO_InitTypeDef gpio = {0};
+
+    Hc05Link_SetKey(0U);
+    gpio.Pin = HC05_KEY_Pin;
+    gpio.Mode = GPIO_MODE_OUTPUT_PP;
+    gpio.Pull = GPIO_NOPULL;
+    gpio.Speed = GPIO_SPEED_FREQ_LOW;
+    HAL_GPIO_Init(HC05_KEY_GPIO_Port, &gpio);
+}
+
+/* Sends one command and collects the reply until "OK", "ERROR" or the timeout. */
+static uint8_t Hc05Link_Command(UART_HandleTypeDef *huart, const char *cmd)
+{
+    char reply[HC05_REPLY_BYTES + 1U];
+    uint32_t len = 0U;
+    uint32_t start;
+
+    ++g_hc05_info.probes;
+
+    /* Drop a stale byte and the overrun it may have caused. */
+    __HAL_UART_CLEAR_OREFLAG(huart);
+    __HAL_UART_FLUSH_DRREGISTER(huart);
+
+    if (HAL_UART_Transmit(huart, (uint8_t *)cmd, (uint16_t)strlen(cmd), BLUETOOTH_AT_TIMEOUT_MS) != HAL_OK)
+    {
+        return 0U;
+    }
+
+    start = HAL_GetTick();
+    while ((HAL_GetTick() - start) < BLUETOOTH_AT_TIMEOUT_MS)
+    {
+        uint8_t c;
+
+        if (HAL_UART_Receive(huart, &c, 1U, 1U) != HAL_OK)
+        {
+            continue;
+        }
+        if (len == HC05_REPLY_BYTES)
+        {
+            /* Keep the tail; the status word comes last. */
+            memmove(reply, &reply[1], HC05_REPLY_BYTES - 1U);
+            --len;
+        }
+        reply[len++] = (char)c;
+        reply[len] = '\0';
+
+        if (strstr(reply, "OK") != NULL)
+        {
+            return 1U;
+        }
+        if (strstr(reply, "ERROR") != NULL)
+        {
+            return 0U;
+        }
+    }
+    return 0U;
+}
+
+static uint8_t Hc05Link_Probe(UART_HandleTypeDef *huart, uint32_t baud)
+{
+    Hc05Link_SetBaud(huart, baud);
+    /* The first probe after a rate change may only resync the module's receiver. */
+    return (uint8_t)((Hc05Link_Command(huart, "AT\r\n") != 0U) || (Hc05Link_Command(huart, "AT\r\n") != 0U));
+}
+
+/* Tries `first`, then the remaining HC-05 rates; 0 when none answers. */
+static uint32_t Hc05Link_FindBaud(UART_HandleTypeDef *huart, uint32_t first)
+{
+    uint32_t i;
+
+    if (Hc05Link_Probe(huart, first) != 0U)
+    {
+        return first;
+    }
+    for (i = 0U; i < HC05_BAUD_COUNT; ++i)
+    {
+        if ((kHc05Bauds[i] != first) && (Hc05Link_Probe(huart, kHc05Bauds[i]) != 0U))
+        {
+            return kHc05Bauds[i];
+        }
+    }
+    return 0U;
+}
+
+static uint8_t Hc05Link_Reconfigure(UART_HandleTypeDef *huart)
+{
+    char cmd[32];
+
+    (void)snprintf(cmd, sizeof(cmd), "AT+UART=%lu,0,0\r\n", (unsigned long)BLUETOOTH_BAUD_TARGET);
+    if (Hc05Link_Command(huart, cmd) == 0U)
+    {
+        return 0U;
+    }
+
+    (void)HAL_UART_Transmit(huart, (uint8_t *)"AT+RESET\r\n", 10U, BLUETOOTH_AT_TIMEOUT_MS);
+    Hc05Link_SetKey(0U);
+    HAL_Delay(BLUETOOTH_AT_RESET_MS);
+
+    Hc05Link_SetKey(1U);
+    HAL_Delay(BLUETOOTH_KEY_SETTLE_MS);
+    return Hc05Link_Probe(huart, BLUETOOTH_BAUD_TARGET);
+}
+
+static void Hc05Link_Negotiate(UART_HandleTypeDef *huart, uint32_t stored)
+{
+    uint32_t found;
+
+    Hc05Link_InitKeyPin();
+    Hc05Link_SetKey(1U);
+    HAL_Delay(BLUETOOTH_KEY_SETTLE_MS);
+
+    found = Hc05Link_FindBaud(huart, stored);
+    if (found == 0U)
+    {
+        g_hc05_info.state = (uint8_t)HC05_LINK_NO_ANSWER;
+        found = stored;
+    }
+    else if (found == BLUETOOTH_BAUD_TARGET)
+    {
+        g_hc05_info.state = (uint8_t)HC05_LINK_KEPT;
+    }
+    else if (Hc05Link_Reconfigure(huart) != 0U)
+    {
+        g_hc05_info.state = (uint8_t)HC05_LINK_RECONFIGURED;
+        found = BLUETOOTH_BAUD_TARGET;
+    }
+    else
+    {
+        /* Whatever the module ended up at after a failed switch. */
+        g_hc05_info.state = (uint8_t)HC05_LINK_RECONFIG_FAILED;
+        found = Hc05Link_FindBaud(huart, found);
+        if (found == 0U)
+        {
+            g_hc05_info.state = (uint8_t)HC05_LINK_NO_ANSWER;
+            found = stored;
+        }
+    }
+
+    Hc05Link_SetKey(0U);
+    Hc05Link_SetBaud(huart, found);
+    g_hc05_info.baud = found;
+}
+#endif
+
+void Hc05Link_Init(UART_HandleTypeDef *huart)
+{
+#if ENABLE_BLUETOOTH
+    uint32_t stored = (uint32_t)ParamStore_Get(PARAM_BT_BAUD) * 100U;
+
+    if (huart == NULL)
+    {
+        return;
+    }
+
+    g_hc05_info.probes = 0U;
+#if BLUETOOTH_AUTOBAUD
+    Hc05Link_Negotiate(huart, stored);
+    if (g_hc05_info.state != (uint8_t)HC05_LINK_NO_ANSWER)
+    {
+        /* Only a rate the module answered at is worth remembering. */
+        (void)ParamStore_Set(PARAM_BT_BAUD, (uint16_t)(g_hc05_info.baud / 100U));
+        if (ParamStore_IsDirty() != 0U)
+        {
+            (void)ParamStore_Save();
+        }
+    }
+#else
+    g_hc05_info.state = (uint8_t)HC05_LINK_FIXED;
+    g_hc05_info.baud = stored;
+    Hc05Link_SetBaud(huart, stored);
+#endif
+#else
+    (void)huart;
+#endif
+}
+
+const Hc05LinkInfo *Hc05Link_GetInfo(void)
+{
+    return &g_hc05_info;
+}
+
+const char *Hc05Link_GetStateName(Hc05LinkState state)
+{
+    switch (state)
+    {
+    case HC05_LINK_KEPT:
+        return "kept";
+    case HC05_LINK_RECONFIGURED:
+        return "set";
+    case HC05_LINK_RECONFIG_FAILED:
+        return "set_failed";
+    case HC05_LINK_NO_ANSWER:
+        return "no_answer";
+    default:
+        return "fixed";
+    }
+}
@@ -0,0 +1,702 @@
+#include "host_cmd.h"
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "app_config.h"
+#include "bluetooth.h"
+#include "cycle_counter.h"
+#include "nav_events.h"
+#include "navigation.h"
+#include "param_store.h"
+#include "stm32f4xx_hal.h"
+
+/*
+ * Lines are parsed in place in the Bluetooth RX ring: a token is a ring
+ * position and a length, and keywords are compared byte by byte, so no
+ * line is ever copied out. Only the validated result goes into the stage,
+ * a small queue that the navigation context drains.
+ */
+#define HOST_CMD_QUEUE_MASK (HOST_CMD_QUEUE_CAPACITY - 1U)
+
+#if (HOST_CMD_QUEUE_CAPACITY == 0U) || ((HOST_CMD_QUEUE_CAPACITY & (HOST_CMD_QUEUE_CAPACITY - 1U)) != 0U)
+#error "HOST_CMD_QUEUE_CAPACITY must be a power of two"
+#endif
+
+#define HOST_CMD_PLAN_SLOTS ((uint8_t)(NAV_SCENE_5_FRONT_LEFT_RIGHT - NAV_SCENE_2_FRONT_ONLY + 1))
+
+typedef struct
+{
+    uint32_t pos;
+    uint32_t len;
+} HostCmdToken;
+
+/* Plan step names, indexed by NavActionType and NavUntil. */
+static const char *const kHostCmdActionNames[] =
+{
+    "none", "pause", "reverse", "backoff", "left", "right", "uturn", "alt", "scan"
+};
+static const char *const kHostCmdUntilNames[] = {"time", "front", "left", "right"};
+
+#define HOST_CMD_ACTION_NAMES (sizeof(kHostCmdActionNames) / sizeof(kHostCmdActionNames[0]))
+#define HOST_CMD_UNTIL_NAMES  (sizeof(kHostCmdUntilNames) / sizeof(kHostCmdUntilNames[0]))
+
+static HostCmdOp g_host_cmd_stage[HOST_CMD_QUEUE_CAPACITY];
+static volatile uint8_t g_host_cmd_head = 0U;
+static volatile uint8_t g_host_cmd_count = 0U;
+/* Latest plan per scene 2..5; a staged HOST_CMD_OP_SET_PLAN picks it up. */
+static NavPlanStep g_host_cmd_plans[HOST_CMD_PLAN_SLOTS][NAV_PLAN_MAX_STEPS];
+static uint8_t g_host_cmd_plan_counts[HOST_CMD_PLAN_SLOTS];
+static HostCmdStats g_host_cmd_stats;
+
+static uint8_t HostCmd_At(const BluetoothRxView *view, uint32_t pos)
+{
+    return view->data[pos & view->mask];
+}
+
+static uint8_t HostCmd_IsSeparator(uint8_t c)
+{
+    return (uint8_t)((c == (uint8_t)' ') || (c == (uint8_t)'\t') || (c == (uint8_t)'=') || (c == (uint8_t)','));
+}
+
+static uint8_t HostCmd_NextToken(const BluetoothRxView *view, uint32_t *pos, uint32_t end, HostCmdToken *token)
+{
+    while ((*pos != end) && (HostCmd_IsSeparator(HostCmd_At(view, *pos)) != 0U))
+    {
+        ++*pos;
+    }
+    token->pos = *pos;
+    while ((*pos != end) && (HostCmd_IsSeparator(HostCmd_At(view, *pos)) == 0U))
+    {
+        ++*pos;
+    }
+    token->len = *pos - token->pos;
+    return (uint8_t)(token->len != 0U);
+}
+
+static uint8_t HostCmd_TokenIs(const BluetoothRxView *view, const HostCmdToken *token, const char *word)
+{
+    uint32_t i;
+
+    for (i = 0U; i < token->len; ++i)
+    {
+        if ((word[i] == '\0') || (HostCmd_At(view, token->pos + i) != (uint8_t)word[i]))
+        {
+            return 0U;
+        }
+    }
+    return (uint8_t)(word[i] == '\0');
+}
+
+static uint8_t HostCmd_TokenToU16(const BluetoothRxView *view, const HostCmdToken *token, uint16_t *value)
+{
+    uint32_t result = 0U;
+    uint32_t i;
+
+    if ((token->len == 0U) || (token->len > 5U))
+    {
+        return 0U;
+    }
+    for (i = 0U; i < token->len; ++i)
+    {
+        uint8_t c = HostCmd_At(view, token->pos + i);
+        if ((c < (uint8_t)'0') || (c > (uint8_t)'9'))
+        {
+            return 0U;
+        }
+        result = (result * 10U) + (uint32_t)(c - (uint8_t)'0');
+    }
+    if (result > 0xFFFFU)
+    {
+        return 0U;
+    }
+    *value = (uint16_t)result;
+    return 1U;
+}
+
+/* A parameter by name or by index. */
+static uint8_t HostCmd_FindParam(const BluetoothRxView *view, const HostCmdToken *token, ParamId *id)
+{
+    uint16_t index;
+    uint8_t i;
+
+    if (HostCmd_TokenToU16(view, token, &index) != 0U)
+    {
+        if (index >= (uint16_t)PARAM_COUNT)
+        {
+            return 0U;
+        }
+        *id = (ParamId)index;
+        return 1U;
+    }
+
+    for (i = 0U; i < (uint8_t)PARAM_COUNT; ++i)
+    {
+        if (HostCmd_TokenIs(view, token, ParamStore_GetName((ParamId)i)) != 0U)
+        {
+            *id = (ParamId)i;
+            return 1U;
+        }
+    }
+    return 0U;
+}
+
+/* A name from the table or its index. */
+static uint8_t HostCmd_FindName(const BluetoothRxView *view, const HostCmdToken *token, const char *const *names,
+                                uint8_t count, uint8_t *index)
+{
+    uint16_t value;
+    uint8_t i;
+
+    if (HostCmd_TokenToU16(view, token, &value) != 0U)
+    {
+        if (value >= (uint16_t)count)
+        {
+            return 0U;
+        }
+        *index = (uint8_t)value;
+        return 1U;
+    }
+
+    for (i = 0U; i < count; ++i)
+    {
+        if (HostCmd_TokenIs(view, token, names[i]) != 0U)
+        {
+            *index = i;
+            return 1U;
+        }
+    }
+    return 0U;
+}
+
+/* Splits the next ':' field off a step token; fields may be empty. */
+static uint8_t HostCmd_NextField(const BluetoothRxView *view, HostCmdToken *rest, HostCmdToken *field)
+{
+    if (rest->len == 0U)
+    {
+        return 0U;
+    }
+
+    field->pos = rest->pos;
+    field->len = 0U;
+    while ((field->len < rest->len) && (HostCmd_At(view, field->pos + field->len) != (uint8_t)':'))
+    {
+        ++field->len;
+    }
+
+    /* Also drop the ':' when there is one. */
+    if (field->len < rest->len)
+    {
+        rest->pos += field->len + 1U;
+        rest->len -= field->len + 1U;
+    }
+    else
+    {
+        rest->pos += field->len;
+        rest->len = 0U;
+    }
+    return 1U;
+}
+
+/* action[:ms[:until[:cm]]]; omitted or empty fields keep the step defaults. */
+static uint8_t HostCmd_ParseStep(const BluetoothRxView *view, const HostCmdToken *token, NavPlanStep *step)
+{
+    HostCmdToken rest = *token;
+    HostCmdToken field;
+    uint16_t value;
+
+    step->action = (uint8_t)NAV_ACTION_NONE;
+    step->until = (uint8_t)NAV_UNTIL_TIMEOUT;
+    step->until_cm = NAV_STEP_DEFAULT_CLEARANCE;
+    step->duration_ms = NAV_STEP_DEFAULT_DURATION;
+
+    if ((HostCmd_NextField(view, &rest, &field) == 0U) ||
+        (HostCmd_FindName(view, &field, kHostCmdActionNames, (uint8_t)HOST_CMD_ACTION_NAMES, &step->action) == 0U))
+    {
+        return 0U;
+    }
+    if ((HostCmd_NextField(view, &rest, &field) != 0U) && (field.len != 0U))
+    {
+        if (HostCmd_TokenToU16(view, &field, &step->duration_ms) == 0U)
+        {
+            return 0U;
+        }
+    }
+    if ((HostCmd_NextField(view, &rest, &field) != 0U) && (field.len != 0U))
+    {
+        if (HostCmd_FindName(view, &field, kHostCmdUntilNames, (uint8_t)HOST_CMD_UNTIL_NAMES, &step->until) == 0U)
+        {
+            return 0U;
+        }
+    }
+    if ((HostCmd_NextField(view, &rest, &field) != 0U) && (field.len != 0U))
+    {
+        if ((HostCmd_TokenToU16(view, &field, &value) == 0U) || (value > 0xFFU))
+        {
+            return 0U;
+        }
+        step->until_cm = (uint8_t)value;
+    }
+    return (uint8_t)(rest.len == 0U);
+}
+
+/* Caller holds PRIMASK. */
+static uint8_t HostCmd_PushLocked(HostCmdOpType type, uint8_t param, uint16_t value)
+{
+    HostCmdOp *slot;
+
+    if (g_host_cmd_count >= HOST_CMD_QUEUE_CAPACITY)
+    {
+        return 0U;
+    }
+
+    slot = &g_host_cmd_stage[(g_host_cmd_head + g_host_cmd_count) & HOST_CMD_QUEUE_MASK];
+    slot->type = (uint8_t)type;
+    slot->param = param;
+    slot->value = value;
+    ++g_host_cmd_count;
+    return 1U;
+}
+
+static uint8_t HostCmd_Stage(HostCmdOpType type, ParamId param, uint16_t value)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint8_t ok;
+
+    __disable_irq();
+    ok = HostCmd_PushLocked(type, (uint8_t)param, value);
+    __set_PRIMASK(primask);
+
+    if (ok == 0U)
+    {
+        ++g_host_cmd_stats.staging_full;
+    }
+    return ok;
+}
+
+/* count 0 stages a clear; the plan slot only changes together with a queued op. */
+static uint8_t HostCmd_StagePlan(NavSceneId scene, const NavPlanStep *steps, uint8_t count)
+{
+    uint8_t slot = (uint8_t)(scene - NAV_SCENE_2_FRONT_ONLY);
+    uint32_t primask = __get_PRIMASK();
+    uint8_t ok = 0U;
+    uint8_t i;
+
+    __disable_irq();
+    if (g_host_cmd_count < HOST_CMD_QUEUE_CAPACITY)
+    {
+        if (count != 0U)
+        {
+            for (i = 0U; i < count; ++i)
+            {
+                g_host_cmd_plans[slot][i] = steps[i];
+            }
+            g_host_cmd_plan_counts[slot] = count;
+        }
+        ok = HostCmd_PushLocked(HOST_CMD_OP_SET_PLAN, (uint8_t)scene, (uint16_t)(count != 0U));
+    }
+    __set_PRIMASK(primask);
+
+    if (ok == 0U)
+    {
+        ++g_host_cmd_stats.staging_full;
+    }
+    return ok;
+}
+
+static void HostCmd_Reply(const char *verb, const char *result)
+{
+    char line[64];
+
+    (void)snprintf(line, sizeof(line), "cmd=%s,%s\r\n", verb, result);
+    Bluetooth_SendText(line);
+}
+
+static void HostCmd_ReplyParam(ParamId id)
+{
+    char line[64];
+
+    (void)snprintf(
+        line,
+        sizeof(line),
+        "param=%s,id=%u,value=%u\r\n",
+        ParamStore_GetName(id),
+        (unsigned int)id,
+        (unsigned int)ParamStore_Get(id));
+    Bluetooth_SendText(line);
+}
+
+static uint8_t HostCmd_Get(const BluetoothRxView *view, uint32_t pos, uint32_t end)
+{
+    HostCmdToken token;
+    ParamId id;
+    uint8_t i;
+
+    if (HostCmd_NextToken(view, &pos, end, &token) == 0U)
+    {
+        for (i = 0U; i < (uint8_t)PARAM_COUNT; ++i)
+        {
+            HostCmd_ReplyParam((ParamId)i);
+        }
+        return 1U;
+    }
+    if (HostCmd_FindParam(view, &token, &id) == 0U)
+    {
+        HostCmd_Reply("get", "err=param");
+        return 0U;
+    }
+    HostCmd_ReplyParam(id);
+    return 1U;
+}
+
+static uint8_t HostCmd_StageParam(const char *verb, ParamId id, uint16_t value)
+{
+    if (ParamStore_IsValid(id, value) == 0U)
+    {
+        HostCmd_Reply(verb, "err=range");
+        return 0U;
+    }
+    if (HostCmd_Stage(HOST_CMD_OP_SET_PARAM, id, value) == 0U)
+    {
+        HostCmd_Reply(verb, "err=busy");
+        return 0U;
+    }
+    HostCmd_Reply(verb, "ok");
+    return 1U;
+}
+
+static uint8_t HostCmd_Set(const BluetoothRxView *view, uint32_t pos, uint32_t end)
+{
+    HostCmdToken name;
+    HostCmdToken value_token;
+    ParamId id;
+    uint16_t value;
+
+    if ((HostCmd_NextToken(view, &pos, end, &name) == 0U) || (HostCmd_FindParam(view, &name, &id) == 0U))
+    {
+        HostCmd_Reply("set", "err=param");
+        return 0U;
+    }
+    if ((HostCmd_NextToken(view, &pos, end, &value_token) == 0U) ||
+        (HostCmd_TokenToU16(view, &value_token, &value) == 0U))
+    {
+        HostCmd_Reply("set", "err=value");
+        return 0U;
+    }
+    return HostCmd_StageParam("set", id, value);
+}
+
+static uint8_t HostCmd_Mode(const BluetoothRxView *view, uint32_t pos, uint32_t end)
+{
+    HostCmdToken token;
+    uint16_t value;
+
+    if (HostCmd_NextToken(view, &pos, end, &token) == 0U)
+    {
+        HostCmd_ReplyParam(PARAM_NAV_MODE);
+        return 1U;
+    }
+    if (HostCmd_TokenIs(view, &token, "scenes") != 0U)
+    {
+        value = (uint16_t)NAV_MODE_SCENES;
+    }
+    else if (HostCmd_TokenIs(view, &token, "reactive") != 0U)
+    {
+        value = (uint16_t)NAV_MODE_REACTIVE;
+    }
+    else if (HostCmd_TokenToU16(view, &token, &value) == 0U)
+    {
+        HostCmd_Reply("mode", "err=value");
+        return 0U;
+    }
+    return HostCmd_StageParam("mode", PARAM_NAV_MODE, value);
+}
+
+static void HostCmd_ReplyPlan(NavSceneId scene)
+{
+    char line[128];
+    const NavPlanStep *steps;
+    uint8_t count = 0U;
+    uint32_t len;
+    uint8_t i;
+
+    len = (uint32_t)snprintf(line, sizeof(line), "plan=%u,steps=", (unsigned int)scene);
+    steps = ParamStore_GetScenePlan(scene, &count);
+    if (steps == NULL)
+    {
+        len += (uint32_t)snprintf(&line[len], sizeof(line) - len, "table");
+    }
+    for (i = 0U; (steps != NULL) && (i < count) && (len < sizeof(line)); ++i)
+    {
+        len += (uint32_t)snprintf(
+            &line[len],
+            sizeof(line) - len,
+            "%s%s:%u:%s:%u",
+            (i != 0U) ? " " : "",
+            kHostCmdActionNames[steps[i].action],
+            (unsigned int)steps[i].duration_ms,
+            kHostCmdUntilNames[steps[i].until],
+            (unsigned int)steps[i].until_cm);
+    }
+    if (len < (sizeof(line) - 2U))
+    {
+        (void)snprintf(&line[len], sizeof(line) - len, "\r\n");
+    }
+    Bluetooth_SendText(line);
+}
+
+static uint8_t HostCmd_Plan(const BluetoothRxView *view, uint32_t pos, uint32_t end)
+{
+    NavPlanStep steps[NAV_PLAN_MAX_STEPS];
+    HostCmdToken token;
+    uint16_t scene;
+    uint8_t count = 0U;
+
+    if ((HostCmd_NextToken(view, &pos, end, &token) == 0U) || (HostCmd_TokenToU16(view, &token, &scene) == 0U) ||
+        (scene < (uint16_t)NAV_SCENE_2_FRONT_ONLY) || (scene > (uint16_t)NAV_SCENE_5_FRONT_LEFT_RIGHT))
+    {
+        HostCmd_Reply("plan", "err=scene");
+        return 0U;
+    }
+
+    if (HostCmd_NextToken(view, &pos, end, &token) == 0U)
+    {
+        HostCmd_ReplyPlan((NavSceneId)scene);
+        return 1U;
+    }
+
+    if (HostCmd_TokenIs(view, &token, "clear") == 0U)
+    {
+        do
+        {
+            if (count == NAV_PLAN_MAX_STEPS)
+            {
+                HostCmd_Reply("plan", "err=steps");
+                return 0U;
+            }
+            if (HostCmd_ParseStep(view, &token, &steps[count]) == 0U)
+            {
+                HostCmd_Reply("plan", "err=step");
+                return 0U;
+            }
+            ++count;
+        } while (HostCmd_NextToken(view, &pos, end, &token) != 0U);
+
+        if (ParamStore_IsScenePlanValid((NavSceneId)scene, steps, count) == 0U)
+        {
+            HostCmd_Reply("plan", "err=range");
+            return 0U;
+        }
+    }
+
+    if (HostCmd_StagePlan((NavSceneId)scene, steps, count) == 0U)
+    {
+        HostCmd_Reply("plan", "err=busy");
+        return 0U;
+    }
+    HostCmd_Reply("plan", "ok");
+    return 1U;
+}
+
+static uint8_t HostCmd_Simple(const char *verb, HostCmdOpType type)
+{
+    if (HostCmd_Stage(type, PARAM_COUNT, 0U) == 0U)
+    {
+        HostCmd_Reply(verb, "err=busy");
+        return 0U;
+    }
+    HostCmd_Reply(verb, "ok");
+    return 1U;
+}
+
+static void HostCmd_Execute(const BluetoothRxView *view, uint32_t pos, uint32_t end)
+{
+    HostCmdToken verb;
+    uint8_t ok;
+
+    if (HostCmd_NextToken(view, &pos, end, &verb) == 0U)
+    {
+        return;
+    }
+
+    if (HostCmd_TokenIs(view, &verb, "get") != 0U)
+    {
+        ok = HostCmd_Get(view, pos, end);
+    }
+    else if (HostCmd_TokenIs(view, &verb, "set") != 0U)
+    {
+        ok = HostCmd_Set(view, pos, end);
+    }
+    else if (HostCmd_TokenIs(view, &verb, "mode") != 0U)
+    {
+        ok = HostCmd_Mode(view, pos, end);
+    }
+    else if (HostCmd_TokenIs(view, &verb, "plan") != 0U)
+    {
+        ok = HostCmd_Plan(view, pos, end);
+    }
+    else if (HostCmd_TokenIs(view, &verb, "stop") != 0U)
+    {
+        ok = HostCmd_Simple("stop", HOST_CMD_OP_STOP);
+    }
+    else if (HostCmd_TokenIs(view, &verb, "start") != 0U)
+    {
+        ok = HostCmd_Simple("start", HOST_CMD_OP_START);
+    }
+    else if (HostCmd_TokenIs(view, &verb, "save") != 0U)
+    {
+        /* The sector erase stalls the CPU; never while driving. */
+        if (Navigation_IsHalted() == 0U)
+        {
+            HostCmd_Reply("save", "err=running");
+            ok = 0U;
+        }
+        else
+        {
+            ok = HostCmd_Simple("save", HOST_CMD_OP_SAVE);
+        }
+    }
+    else
+    {
+        HostCmd_Reply("err", "unknown");
+        ok = 0U;
+    }
+
+    if (ok != 0U)
+    {
+        ++g_host_cmd_stats.accepted;
+    }
+    else
+    {
+        ++g_host_cmd_stats.rejected;
+    }
+}
+
+void HostCmd_Init(void)
+{
+    uint8_t i;
+
+    g_host_cmd_head = 0U;
+    g_host_cmd_count = 0U;
+    for (i = 0U; i < HOST_CMD_PLAN_SLOTS; ++i)
+    {
+        g_host_cmd_plan_counts[i] = 0U;
+    }
+    g_host_cmd_stats.accepted = 0U;
+    g_host_cmd_stats.rejected = 0U;
+    g_host_cmd_stats.staging_full = 0U;
+}
+
+void HostCmd_Poll(void)
+{
+    BluetoothRxView view;
+    uint32_t line_start;
+    uint32_t pos;
+    uint32_t stamp = CycleCounter_Now();
+
+    if (Bluetooth_GetRxView(&view) != 0U)
+    {
+        if (view.frame_end == view.end)
+        {
+            /* The burst is complete: measure latency from its idle line. */
+            stamp = view.frame_stamp_cycles;
+        }
+
+        line_start = view.start;
+        for (pos = view.start; pos != view.end; ++pos)
+        {
+            uint8_t c = HostCmd_At(&view, pos);
+            if ((c == (uint8_t)'\r') || (c == (uint8_t)'\n') || (c == (uint8_t)';'))
+            {
+                HostCmd_Execute(&view, line_start, pos);
+                line_start = pos + 1U;
+            }
+        }
+
+        /* An idle line ends the last command of a burst without a terminator. */
+        if (((int32_t)(view.frame_end - line_start) > 0) && ((int32_t)(view.end - view.frame_end) >= 0))
+        {
+            HostCmd_Execute(&view, line_start, view.frame_end);
+            line_start = view.frame_end;
+        }
+        else if ((view.end - line_start) > HOST_CMD_MAX_LINE)
+        {
+            HostCmd_Reply("err", "too_long");
+            ++g_host_cmd_stats.rejected;
+            line_start = view.end;
+        }
+        Bluetooth_ConsumeRx(line_start);
+    }
+
+    /* Re-posted until navigation drains the stage, in case the event queue was full. */
+    if (g_host_cmd_count != 0U)
+    {
+        (void)NavEvents_Post(NAV_EVENT_COMMAND, g_host_cmd_count, stamp);
+    }
+}
+
+uint8_t HostCmd_PopStaged(HostCmdOp *op)
+{
+    uint32_t primask;
+    uint8_t ok = 0U;
+
+    if (op == NULL)
+    {
+        return 0U;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (g_host_cmd_count != 0U)
+    {
+        *op = g_host_cmd_stage[g_host_cmd_head];
+        g_host_cmd_head = (uint8_t)((g_host_cmd_head + 1U) & HOST_CMD_QUEUE_MASK);
+        --g_host_cmd_count;
+        ok = 1U;
+    }
+    __set_PRIMASK(primask);
+    return ok;
+}
+
+uint8_t HostCmd_GetStagedPlan(NavSceneId scene, NavPlanStep *steps)
+{
+    uint8_t slot;
+    uint32_t primask;
+    uint8_t count = 0U;
+    uint8_t i;
+
+    if ((steps == NULL) || (scene < NAV_SCENE_2_FRONT_ONLY) || (scene > NAV_SCENE_5_FRONT_LEFT_RIGHT))
+    {
+        return 0U;
+    }
+
+    slot = (uint8_t)(scene - NAV_SCENE_2_FRONT_ONLY);
+    primask = __get_PRIMASK();
+    __disable_irq();
+    count = g_host_cmd_plan_counts[slot];
+    for (i = 0U; i < count; ++i)
+    {
+        steps[i] = g_host_cmd_plans[slot][i];
+    }
+    __set_PRIMASK(primask);
+    return count;
+}
+
+const HostCmdStats *HostCmd_GetStats(void)
+{
+    return &g_host_cmd_stats;
+}
+
+void HostCmd_SendStats(void)
+{
+    char line[64];
+
+    (void)snprintf(
+        line,
+        sizeof(line),
+        "cmd=stats,ok=%u,rej=%u,full=%u\r\n",
+        (unsigned int)g_host_cmd_stats.accepted,
+        (unsigned int)g_host_cmd_stats.rejected,
+        (unsigned int)g_host_cmd_stats.staging_full);
+    Bluetooth_SendText(line);
+}
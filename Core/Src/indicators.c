@@ -1,37 +1,301 @@
 #include "indicators.h"
 
+#include <stddef.h>
+
+#include "app_config.h"
+#include "cycle_counter.h"
+#include "gpio_out.h"
 #include "pin_map.h"
-#include "stm32f4xx_hal.h"
 
-void Indicators_Init(void)
+/*
+ * The LEDs show the live status (g_ind_base_leds) unless a queued pattern or
+ * a fault code owns them. A fault code has priority: it flushes the queue and
+ * repeats until cleared. The timer only runs while a pattern or fault plays.
+ */
+
+#define INDICATOR_QUEUE_MASK (INDICATOR_QUEUE_CAPACITY - 1U)
+
+#if (INDICATOR_QUEUE_CAPACITY == 0U) || ((INDICATOR_QUEUE_CAPACITY & (INDICATOR_QUEUE_CAPACITY - 1U)) != 0U)
+#error "INDICATOR_QUEUE_CAPACITY must be a power of two"
+#endif
+
+static TIM_HandleTypeDef *g_ind_tim = NULL;
+
+static IndicatorStep g_ind_queue[INDICATOR_QUEUE_CAPACITY];
+static volatile uint8_t g_ind_head = 0U;
+static volatile uint8_t g_ind_count = 0U;
+
+static volatile uint8_t g_ind_base_leds = 0U;
+static volatile uint8_t g_ind_playing = 0U;
+static uint16_t g_ind_remaining_ticks = 0U;
+
+static volatile uint8_t g_ind_fault_code = 0U;
+static uint8_t g_ind_fault_step = 0U;
+
+static void Indicators_Write(uint8_t leds)
+{
+    /* Also used by the timer interrupt and the fault loop, so never staged. */
+    GpioOut_WriteNow(LED_OBSTACLE_GPIO_Port, LED_OBSTACLE_Pin, (uint8_t)((leds & INDICATOR_LED_OBSTACLE) != 0U));
+    GpioOut_WriteNow(LED_MARK_GPIO_Port, LED_MARK_Pin, (uint8_t)((leds & INDICATOR_LED_MARK) != 0U));
+}
+
+/* Step `index` of a fault code: `code` blinks of both LEDs, then a long pause. */
+static IndicatorStep Indicators_FaultStep(uint8_t code, uint8_t index)
+{
+    IndicatorStep step;
+
+    if ((index & 1U) == 0U)
+    {
+        step.duration_ms = INDICATOR_FAULT_ON_MS;
+        step.leds = INDICATOR_LED_BOTH;
+    }
+    else
+    {
+        step.duration_ms = ((uint8_t)(index + 1U) >= (uint8_t)(code * 2U)) ? INDICATOR_FAULT_PAUSE_MS : INDICATOR_FAULT_OFF_MS;
+        step.leds = 0U;
+    }
+    return step;
+}
+
+static void Indicators_StartStep(const IndicatorStep *step)
 {
-    Indicators_SetObstacleLed(0U);
-    Indicators_SetMarkLed(0U);
+    g_ind_remaining_ticks = (uint16_t)((step->duration_ms + INDICATOR_TICK_MS - 1U) / INDICATOR_TICK_MS);
+    if (g_ind_remaining_ticks == 0U)
+    {
+        g_ind_remaining_ticks = 1U;
+    }
+    Indicators_Write(step->leds);
+}
+
+/* Caller holds the queue: interrupt context or PRIMASK set. */
+static uint8_t Indicators_StartNext(void)
+{
+    IndicatorStep step;
+
+    if (g_ind_fault_code != 0U)
+    {
+        step = Indicators_FaultStep(g_ind_fault_code, g_ind_fault_step);
+        g_ind_fault_step = (uint8_t)((g_ind_fault_step + 1U) % (uint8_t)(g_ind_fault_code * 2U));
+        Indicators_StartStep(&step);
+        g_ind_playing = 1U;
+        return 1U;
+    }
+
+    if (g_ind_count != 0U)
+    {
+        step = g_ind_queue[g_ind_head];
+        g_ind_head = (uint8_t)((g_ind_head + 1U) & INDICATOR_QUEUE_MASK);
+        --g_ind_count;
+        Indicators_StartStep(&step);
+        g_ind_playing = 1U;
+        return 1U;
+    }
+
+    g_ind_playing = 0U;
+    Indicators_Write(g_ind_base_leds);
+    return 0U;
+}
+
+/* Caller holds the queue. */
+static void Indicators_Kick(void)
+{
+    if ((g_ind_playing == 0U) && (Indicators_StartNext() != 0U))
+    {
+        __HAL_TIM_SET_COUNTER(g_ind_tim, 0U);
+        __HAL_TIM_CLEAR_FLAG(g_ind_tim, TIM_FLAG_UPDATE);
+        (void)HAL_TIM_Base_Start_IT(g_ind_tim);
+    }
+}
+
+static void Indicators_SetBase(uint8_t mask, uint8_t on)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    g_ind_base_leds = (on != 0U) ? (uint8_t)(g_ind_base_leds | mask) : (uint8_t)(g_ind_base_leds & (uint8_t)~mask);
+    if (g_ind_playing == 0U)
+    {
+        Indicators_Write(g_ind_base_leds);
+    }
+    __set_PRIMASK(primask);
+}
+
+void Indicators_Init(TIM_HandleTypeDef *htim)
+{
+    g_ind_tim = htim;
+    g_ind_head = 0U;
+    g_ind_count = 0U;
+    g_ind_playing = 0U;
+    g_ind_fault_code = 0U;
+    g_ind_base_leds = 0U;
+    Indicators_Write(0U);
 }
 
 void Indicators_SetObstacleLed(uint8_t on)
 {
-    HAL_GPIO_WritePin(LED_OBSTACLE_GPIO_Port, LED_OBSTACLE_Pin, (on != 0U) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+    Indicators_SetBase(INDICATOR_LED_OBSTACLE, on);
 }
 
 void Indicators_SetMarkLed(uint8_t on)
 {
-    HAL_GPIO_WritePin(LED_MARK_GPIO_Port, LED_MARK_Pin, (on != 0U) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+    Indicators_SetBase(INDICATOR_LED_MARK, on);
+}
+
+uint8_t Indicators_Enqueue(const IndicatorStep *steps, uint8_t count)
+{
+    uint32_t primask;
+    uint8_t ok = 0U;
+    uint8_t i;
+
+    if ((g_ind_tim == NULL) || (steps == NULL) || (count == 0U))
+    {
+        return 0U;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    /* Status patterns are not queued behind a fault; it may never end. */
+    if ((g_ind_fault_code == 0U) && ((uint32_t)g_ind_count + count <= INDICATOR_QUEUE_CAPACITY))
+    {
+        for (i = 0U; i < count; ++i)
+        {
+            g_ind_queue[(g_ind_head + g_ind_count) & INDICATOR_QUEUE_MASK] = steps[i];
+            ++g_ind_count;
+        }
+        Indicators_Kick();
+        ok = 1U;
+    }
+    __set_PRIMASK(primask);
+
+    return ok;
 }
 
-void Indicators_BlinkBoth(uint8_t count, uint16_t on_ms, uint16_t off_ms)
+uint8_t Indicators_Blink(uint8_t leds, uint8_t count, uint16_t on_ms, uint16_t off_ms)
 {
+    IndicatorStep pattern[INDICATOR_QUEUE_CAPACITY];
+    uint8_t n = 0U;
     uint8_t i;
-    for (i = 0U; i < count; ++i)
-    {
-        Indicators_SetObstacleLed(1U);
-        Indicators_SetMarkLed(1U);
-        HAL_Delay(on_ms);
-        Indicators_SetObstacleLed(0U);
-        Indicators_SetMarkLed(0U);
-        if ((i + 1U) < count)
+
+    for (i = 0U; (i < count) && (n < INDICATOR_QUEUE_CAPACITY); ++i)
+    {
+        pattern[n].duration_ms = on_ms;
+        pattern[n].leds = leds;
+        ++n;
+        if (((i + 1U) < count) && (n < INDICATOR_QUEUE_CAPACITY))
+        {
+            pattern[n].duration_ms = off_ms;
+            pattern[n].leds = 0U;
+            ++n;
+        }
+    }
+
+    return Indicators_Enqueue(pattern, n);
+}
+
+void Indicators_ShowFault(uint8_t code)
+{
+    uint32_t primask;
+
+    if ((g_ind_tim == NULL) || (code == 0U))
+    {
+        return;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    g_ind_count = 0U;
+    g_ind_fault_code = code;
+    g_ind_fault_step = 0U;
+    /* Restart at the first blink so the code is read from its beginning. */
+    g_ind_playing = 0U;
+    Indicators_Kick();
+    __set_PRIMASK(primask);
+}
+
+void Indicators_ClearFault(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if ((g_ind_fault_code != 0U) && (g_ind_tim != NULL))
+    {
+        g_ind_fault_code = 0U;
+        /* Back to the queue or the live status now, not after the pause. */
+        if (Indicators_StartNext() == 0U)
         {
-            HAL_Delay(off_ms);
+            (void)HAL_TIM_Base_Stop_IT(g_ind_tim);
         }
     }
+    __set_PRIMASK(primask);
+}
+
+uint8_t Indicators_GetFault(void)
+{
+    return g_ind_fault_code;
+}
+
+void Indicators_OnTimerIrq(void)
+{
+    if ((g_ind_tim == NULL) || (__HAL_TIM_GET_FLAG(g_ind_tim, TIM_FLAG_UPDATE) == RESET))
+    {
+        return;
+    }
+    __HAL_TIM_CLEAR_FLAG(g_ind_tim, TIM_FLAG_UPDATE);
+
+    if ((g_ind_playing == 0U) || (--g_ind_remaining_ticks != 0U))
+    {
+        return;
+    }
+
+    if (Indicators_StartNext() == 0U)
+    {
+        (void)HAL_TIM_Base_Stop_IT(g_ind_tim);
+    }
+}
+
+static void Indicators_DelayMs(uint32_t ms)
+{
+    uint32_t cycles_per_ms = SystemCoreClock / 1000U;
+
+    while (ms-- != 0U)
+    {
+        uint32_t start = CycleCounter_Now();
+
+        while ((CycleCounter_Now() - start) < cycles_per_ms)
+        {
+        }
+    }
+}
+
+__NO_RETURN void Indicators_FaultLoop(uint8_t code)
+{
+    GPIO_InitTypeDef gpio = {0};
+    uint8_t index = 0U;
+
+    __disable_irq();
+    if (code == 0U)
+    {
+        code = INDICATOR_FAULT_INIT;
+    }
+
+    /* The fault may precede MX_GPIO_Init() or CycleCounter_Init(). */
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    __HAL_RCC_GPIOC_CLK_ENABLE();
+    gpio.Mode = GPIO_MODE_OUTPUT_PP;
+    gpio.Pull = GPIO_NOPULL;
+    gpio.Speed = GPIO_SPEED_FREQ_LOW;
+    gpio.Pin = LED_OBSTACLE_Pin;
+    HAL_GPIO_Init(LED_OBSTACLE_GPIO_Port, &gpio);
+    gpio.Pin = LED_MARK_Pin;
+    HAL_GPIO_Init(LED_MARK_GPIO_Port, &gpio);
+    CycleCounter_Init();
+
+    while (1)
+    {
+        IndicatorStep step = Indicators_FaultStep(code, index);
+
+        Indicators_Write(step.leds);
+        Indicators_DelayMs(step.duration_ms);
+        index = (uint8_t)((index + 1U) % (uint8_t)(code * 2U));
+    }
 }
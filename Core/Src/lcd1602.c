@@ -3,6 +3,8 @@
 #include <string.h>
 
 #include "app_config.h"
+#include "gpio_out.h"
+#include "gpio_pin.h"
 #include "pin_map.h"
 #include "stm32f4xx_hal.h"
 
@@ -27,52 +29,30 @@ static void Lcd1602_DelayUs(uint32_t us)
 
 static void Lcd1602_ConfigPinsForWrite(void)
 {
-    GPIO_InitTypeDef gpio = {0};
-
-    gpio.Mode = GPIO_MODE_OUTPUT_PP;
-    gpio.Pull = GPIO_NOPULL;
-    gpio.Speed = GPIO_SPEED_FREQ_LOW;
-
-    gpio.Pin = LCD_RS_Pin | LCD_E_Pin;
-    HAL_GPIO_Init(LCD_RS_GPIO_Port, &gpio);
-
-    gpio.Pin = LCD_D4_Pin;
-    HAL_GPIO_Init(LCD_D4_GPIO_Port, &gpio);
-    gpio.Pin = LCD_D5_Pin;
-    HAL_GPIO_Init(LCD_D5_GPIO_Port, &gpio);
-    gpio.Pin = LCD_D6_Pin;
-    HAL_GPIO_Init(LCD_D6_GPIO_Port, &gpio);
-    gpio.Pin = LCD_D7_Pin;
-    HAL_GPIO_Init(LCD_D7_GPIO_Port, &gpio);
-
+    GpioPin_ConfigLcdOutputs();
     g_lcd_pins_ready = 1U;
 }
 
 static void Lcd1602_EnsurePinsForWrite(void)
 {
-#if ENABLE_BLUETOOTH && LCD_UART2_PA23_SHARED
-    Lcd1602_ConfigPinsForWrite();
-#else
     if (g_lcd_pins_ready == 0U)
     {
         Lcd1602_ConfigPinsForWrite();
     }
-#endif
 }
 
 static void Lcd1602_WriteDataPins(uint8_t nibble)
 {
-    HAL_GPIO_WritePin(LCD_D4_GPIO_Port, LCD_D4_Pin, ((nibble & 0x01U) != 0U) ? GPIO_PIN_SET : GPIO_PIN_RESET);
-    HAL_GPIO_WritePin(LCD_D5_GPIO_Port, LCD_D5_Pin, ((nibble & 0x02U) != 0U) ? GPIO_PIN_SET : GPIO_PIN_RESET);
-    HAL_GPIO_WritePin(LCD_D6_GPIO_Port, LCD_D6_Pin, ((nibble & 0x04U) != 0U) ? GPIO_PIN_SET : GPIO_PIN_RESET);
-    HAL_GPIO_WritePin(LCD_D7_GPIO_Port, LCD_D7_Pin, ((nibble & 0x08U) != 0U) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+    GpioPin_StageLcdData(nibble);
+    /* Data (and RS) must be on the pins before E rises. */
+    GpioOut_Flush();
 }
 
 static void Lcd1602_PulseEnable(void)
 {
-    HAL_GPIO_WritePin(LCD_E_GPIO_Port, LCD_E_Pin, GPIO_PIN_SET);
+    GpioOut_WriteNow(LCD_E_GPIO_Port, LCD_E_Pin, 1U);
     Lcd1602_DelayUs(2U);
-    HAL_GPIO_WritePin(LCD_E_GPIO_Port, LCD_E_Pin, GPIO_PIN_RESET);
+    GpioOut_WriteNow(LCD_E_GPIO_Port, LCD_E_Pin, 0U);
     Lcd1602_DelayUs(50U);
 }
 
@@ -85,7 +65,7 @@ static void Lcd1602_SendNibble(uint8_t nibble)
 static void Lcd1602_SendByte(uint8_t value, uint8_t is_data)
 {
     Lcd1602_EnsurePinsForWrite();
-    HAL_GPIO_WritePin(LCD_RS_GPIO_Port, LCD_RS_Pin, (is_data != 0U) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+    GpioOut_Write(LCD_RS_GPIO_Port, LCD_RS_Pin, is_data);
     Lcd1602_SendNibble((uint8_t)(value >> 4U));
     Lcd1602_SendNibble((uint8_t)(value & 0x0FU));
     Lcd1602_DelayUs(50U);
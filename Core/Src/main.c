@@ -5,16 +5,29 @@
 #include "app_config.h"
 #include "bluetooth.h"
 #include "buzzer.h"
+#include "cycle_counter.h"
+#include "gpio_out.h"
+#include "hc05_link.h"
+#include "host_cmd.h"
 #include "indicators.h"
 #include "lcd1602.h"
 #include "motor.h"
 #include "navigation.h"
+#include "param_store.h"
 #include "pin_map.h"
+#include "route_memory.h"
+#include "rtos_app.h"
+#include "scheduler.h"
 #include "sensors.h"
 #include "seven_seg.h"
+#include "turn_calib.h"
 
 ADC_HandleTypeDef hadc1;
 UART_HandleTypeDef huart2;
+DMA_HandleTypeDef hdma_usart2_tx;
+DMA_HandleTypeDef hdma_usart2_rx;
+TIM_HandleTypeDef htim10;
+TIM_HandleTypeDef htim11;
 #if ENABLE_MOTOR_PWM
 TIM_HandleTypeDef htim2;
 TIM_HandleTypeDef htim3;
@@ -23,7 +36,10 @@ TIM_HandleTypeDef htim3;
 static void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
 static void MX_ADC1_Init(void);
+static void MX_DMA_Init(void);
 static void MX_USART2_UART_Init(void);
+static void MX_TIM10_Init(void);
+static void MX_TIM11_Init(void);
 #if ENABLE_MOTOR_PWM
 static void MX_TIM2_Init(void);
 static void MX_TIM3_Init(void);
@@ -75,67 +91,335 @@ static void Lcd_ShowStatus(void)
 }
 #endif
 
-int main(void)
+#if ENABLE_BLUETOOTH
+static uint8_t g_telemetry_reports_since_stats = 0U;
+
+void App_SendModuleStats(void)
+{
+    const NavStats *nav = Navigation_GetStats();
+    const RouteStats *route = RouteMemory_GetStats();
+    const TurnCalibStats *calib = TurnCalib_GetStats();
+    const NavEventStats *events = NavEvents_GetStats();
+    char line[96];
+    uint8_t i;
+
+    for (i = 0U; i < (uint8_t)NAV_EVENT_TYPE_COUNT; ++i)
+    {
+        const NavLatencyStats *latency = NavEvents_GetLatency((NavEventType)i);
+
+        (void)snprintf(
+            line,
+            sizeof(line),
+            "evt=%s,n=%lu,last=%lu,max=%lu,avg=%lu\r\n",
+            NavEvents_GetTypeName((NavEventType)i),
+            (unsigned long)latency->count,
+            (unsigned long)latency->last_us,
+            (unsigned long)latency->max_us,
+            (unsigned long)((latency->count != 0U) ? (latency->total_us / latency->count) : 0U));
+        Bluetooth_SendText(line);
+    }
+    (void)snprintf(
+        line,
+        sizeof(line),
+        "evt=queue,dropped=%u,skipped_samples=%u\r\n",
+        (unsigned int)events->dropped,
+        (unsigned int)events->skipped_samples);
+    Bluetooth_SendText(line);
+
+    (void)snprintf(
+        line,
+        sizeof(line),
+        "nav=stats,guard=%u,early=%u,timeout=%u,scans=%u,no_opening=%u\r\n",
+        (unsigned int)nav->guard_aborts,
+        (unsigned int)nav->early_exits,
+        (unsigned int)nav->timeouts,
+        (unsigned int)nav->scans,
+        (unsigned int)nav->scan_no_opening);
+    Bluetooth_SendText(line);
+    (void)snprintf(
+        line,
+        sizeof(line),
+        "nav=stalls,no_progress=%u,oscillation=%u,preempt_drop=%u,preempt_refused=%u\r\n",
+        (unsigned int)nav->stalls_no_progress,
+        (unsigned int)nav->stalls_oscillation,
+        (unsigned int)nav->preempt_drops,
+        (unsigned int)nav->preempt_refused);
+    Bluetooth_SendText(line);
+    (void)snprintf(
+        line,
+        sizeof(line),
+        "route=stats,branches=%u,dead_ends=%u,avoid=%u\r\n",
+        (unsigned int)route->branches,
+        (unsigned int)route->dead_ends,
+        (unsigned int)route->avoidances);
+    Bluetooth_SendText(line);
+    (void)snprintf(
+        line,
+        sizeof(line),
+        "calib=turn,updates=%u,rejects=%u,left=%u,right=%u\r\n",
+        (unsigned int)calib->updates,
+        (unsigned int)calib->rejects,
+        (unsigned int)ParamStore_Get(PARAM_TURN_LEFT_90_MS),
+        (unsigned int)ParamStore_Get(PARAM_TURN_RIGHT_90_MS));
+    Bluetooth_SendText(line);
+    (void)snprintf(
+        line,
+        sizeof(line),
+        "buzzer=stats,dropped=%u\r\n",
+        (unsigned int)Buzzer_GetDropped());
+    Bluetooth_SendText(line);
+}
+
+static void Telemetry_SendSchedulerStats(void)
+{
+    char line[96];
+    uint8_t i;
+
+    for (i = 0U; i < (uint8_t)SCHED_TASK_COUNT; ++i)
+    {
+        const SchedTaskStats *stats = Scheduler_GetStats((SchedTaskId)i);
+
+        (void)snprintf(
+            line,
+            sizeof(line),
+            "task=%s,runs=%lu,exec=%lu,max=%lu,jit=%lu,miss=%u,skip=%u\r\n",
+            Scheduler_GetTaskName((SchedTaskId)i),
+            (unsigned long)stats->runs,
+            (unsigned long)stats->last_exec_us,
+            (unsigned long)stats->max_exec_us,
+            (unsigned long)stats->max_jitter_ms,
+            (unsigned int)stats->deadline_misses,
+            (unsigned int)stats->skipped_releases);
+        Bluetooth_SendText(line);
+    }
+    App_SendModuleStats();
+    Bluetooth_SendTxStats();
+    Bluetooth_SendRxStats();
+    HostCmd_SendStats();
+}
+
+static void Telemetry_SendStatus(void)
+{
+    TelemetryStatus status;
+
+    if (++g_telemetry_reports_since_stats >= SCHED_REPORT_EVERY)
+    {
+        g_telemetry_reports_since_stats = 0U;
+        Telemetry_SendSchedulerStats();
+    }
+
+    status.time_ms = HAL_GetTick();
+    status.snapshot = *Sensors_GetSnapshot();
+    Navigation_GetPose(&status.pose);
+    status.speed = *SpeedModel_GetLastSample();
+    status.counter = Navigation_GetCounter();
+    status.scene = (uint8_t)Navigation_GetCurrentScene();
+    status.motion = (uint8_t)Navigation_GetMotion();
+    Bluetooth_SendStatus(&status);
+}
+#endif
+
+#if ENABLE_BLUETOOTH && GPIO_OUT_BENCHMARK
+static void Telemetry_SendGpioBenchmark(void)
+{
+    GpioOutBenchmark bench;
+    char line[96];
+
+    GpioOut_RunBenchmark(&bench);
+    (void)snprintf(
+        line,
+        sizeof(line),
+        "bench=gpio,seg_hal=%lu,seg_shadow=%lu,lcd_hal=%lu,lcd_shadow=%lu\r\n",
+        (unsigned long)bench.seg_hal_cycles,
+        (unsigned long)bench.seg_shadow_cycles,
+        (unsigned long)bench.lcd_hal_cycles,
+        (unsigned long)bench.lcd_shadow_cycles);
+    Bluetooth_SendText(line);
+}
+#endif
+
+#if ENABLE_BLUETOOTH && DRIVER_BACKEND_BENCHMARK
+typedef struct
+{
+    uint32_t sensors_update_cycles; /* four ADC conversions plus filtering */
+    uint32_t motor_speed_cycles;    /* two PWM compare updates */
+    uint32_t buzzer_pin_cycles;
+} BackendBenchmark;
+
+static BackendBenchmark g_backend_bench;
+
+static void Benchmark_MotorSpeed(void)
+{
+    Motor_SetSpeed(MOTOR_SPEED_FORWARD_PERCENT, MOTOR_SPEED_TURN_PERCENT);
+}
+
+/* Minimum over the rounds, so a SysTick landing inside a call does not count. */
+static uint32_t Benchmark_TimeCall(void (*call)(void))
+{
+    uint32_t best = 0xFFFFFFFFU;
+    uint32_t round;
+
+    for (round = 0U; round < DRIVER_BACKEND_BENCHMARK_ROUNDS; ++round)
+    {
+        uint32_t start = CycleCounter_Now();
+        uint32_t cycles;
+
+        call();
+        cycles = CycleCounter_Now() - start;
+        if (cycles < best)
+        {
+            best = cycles;
+        }
+    }
+    return best;
+}
+
+/* Runs before Navigation_Init(); re-initializes what the calls disturbed. */
+static void Benchmark_RunBackend(void)
+{
+    g_backend_bench.sensors_update_cycles = Benchmark_TimeCall(Sensors_Update);
+    g_backend_bench.motor_speed_cycles = Benchmark_TimeCall(Benchmark_MotorSpeed);
+    g_backend_bench.buzzer_pin_cycles = Benchmark_TimeCall(Buzzer_Off);
+
+    Sensors_Init(&hadc1);
+    Motor_Init();
+}
+
+static void Telemetry_SendBackendBenchmark(void)
+{
+    char line[96];
+
+    (void)snprintf(
+        line,
+        sizeof(line),
+        "bench=backend,ll=%u,sensors=%lu,motor=%lu,buzzer=%lu\r\n",
+        (unsigned int)DRIVER_BACKEND_LL,
+        (unsigned long)g_backend_bench.sensors_update_cycles,
+        (unsigned long)g_backend_bench.motor_speed_cycles,
+        (unsigned long)g_backend_bench.buzzer_pin_cycles);
+    Bluetooth_SendText(line);
+}
+#endif
+
+#if ENABLE_BLUETOOTH
+static void Telemetry_SendLinkInfo(void)
 {
+    const Hc05LinkInfo *link = Hc05Link_GetInfo();
+    char line[64];
+
+    (void)snprintf(
+        line,
+        sizeof(line),
+        "link=hc05,baud=%lu,state=%s,probes=%u\r\n",
+        (unsigned long)link->baud,
+        Hc05Link_GetStateName((Hc05LinkState)link->state),
+        (unsigned int)link->probes);
+    Bluetooth_SendText(line);
+}
+#endif
+
+void App_RunTask(SchedTaskId id)
+{
+    switch (id)
+    {
+    case SCHED_TASK_NAVIGATION:
+    {
+        NavEvent event;
+
+        while (NavEvents_Pop(&event) != 0U)
+        {
+            Navigation_HandleEvent(&event);
+        }
+        break;
+    }
+
+    case SCHED_TASK_TELEMETRY:
 #if ENABLE_BLUETOOTH
-    uint32_t last_bluetooth_report_ms = 0U;
+        Telemetry_SendStatus();
 #endif
+        break;
+
+    case SCHED_TASK_LCD:
 #if ENABLE_LCD
-    uint32_t last_lcd_refresh_ms = 0U;
+        Lcd_ShowStatus();
 #endif
+        break;
+
+    case SCHED_TASK_COMMAND:
+#if ENABLE_BLUETOOTH
+        HostCmd_Poll();
+#endif
+        break;
+
+    default:
+        break;
+    }
+}
 
+int main(void)
+{
     HAL_Init();
     SystemClock_Config();
+    CycleCounter_Init();
+#if ENABLE_RTOS
+    if (RtosApp_InitKernel() == 0U)
+    {
+        Error_Handler();
+    }
+#endif
 
     MX_GPIO_Init();
     MX_ADC1_Init();
+    MX_DMA_Init();
     MX_USART2_UART_Init();
+    MX_TIM10_Init();
+    MX_TIM11_Init();
 #if ENABLE_MOTOR_PWM
     MX_TIM2_Init();
     MX_TIM3_Init();
     Motor_SetPwmChannels(&htim3, TIM_CHANNEL_2, &htim2, TIM_CHANNEL_2);
 #endif
 
+    GpioOut_Init();
     Motor_Init();
     Sensors_Init(&hadc1);
     SevenSeg_Init();
-    Buzzer_Init();
-    Indicators_Init();
+    Buzzer_Init(&htim10);
+    Indicators_Init(&htim11);
+    ParamStore_Init();
+    Hc05Link_Init(&huart2);
     Bluetooth_Init(&huart2);
+#if ENABLE_BLUETOOTH && DRIVER_BACKEND_BENCHMARK
+    Benchmark_RunBackend();
+#endif
 #if ENABLE_LCD
     Lcd1602_Init();
 #endif
+    HostCmd_Init();
     Navigation_Init();
+    GpioOut_Flush();
 
 #if ENABLE_BLUETOOTH
     Bluetooth_SendText("boot:navcar ready\r\n");
+    Telemetry_SendLinkInfo();
+#if GPIO_OUT_BENCHMARK
+    Telemetry_SendGpioBenchmark();
 #endif
-
-    while (1)
-    {
-        Navigation_Process();
-
-#if ENABLE_BLUETOOTH
-        if ((HAL_GetTick() - last_bluetooth_report_ms) >= BLUETOOTH_STATUS_PERIOD_MS)
-        {
-            Bluetooth_SendStatus(
-                Navigation_GetCounter(),
-                (uint8_t)Navigation_GetCurrentScene(),
-                Sensors_GetSnapshot());
-            last_bluetooth_report_ms = HAL_GetTick();
-        }
+#if DRIVER_BACKEND_BENCHMARK
+    Telemetry_SendBackendBenchmark();
 #endif
-
-#if ENABLE_LCD
-        if ((HAL_GetTick() - last_lcd_refresh_ms) >= LCD_REFRESH_PERIOD_MS)
-        {
-            Lcd_ShowStatus();
-            last_lcd_refresh_ms = HAL_GetTick();
-        }
 #endif
 
-        HAL_Delay(MAIN_LOOP_PERIOD_MS);
+#if ENABLE_RTOS
+    RtosApp_Start();
+    Error_Handler();
+#else
+    Scheduler_Init(HAL_GetTick());
+    while (1)
+    {
+        Scheduler_RunOnce();
     }
+#endif
 }
 
 static void SystemClock_Config(void)
@@ -191,10 +475,23 @@ static void MX_ADC1_Init(void)
     }
 }
 
+/*
+ * USART2_TX is DMA1 stream 6 and USART2_RX stream 5, both channel 4; the
+ * streams themselves are set up in HAL_UART_MspInit().
+ */
+static void MX_DMA_Init(void)
+{
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    HAL_NVIC_SetPriority(DMA1_Stream5_IRQn, BLUETOOTH_IRQ_PRIORITY, 0U);
+    HAL_NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+    HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, BLUETOOTH_IRQ_PRIORITY, 0U);
+    HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+}
+
 static void MX_USART2_UART_Init(void)
 {
     huart2.Instance = USART2;
-    huart2.Init.BaudRate = 9600;
+    huart2.Init.BaudRate = BLUETOOTH_BAUD_DEFAULT; /* hc05_link.c switches to the negotiated rate */
     huart2.Init.WordLength = UART_WORDLENGTH_8B;
     huart2.Init.StopBits = UART_STOPBITS_1;
     huart2.Init.Parity = UART_PARITY_NONE;
@@ -207,6 +504,36 @@ static void MX_USART2_UART_Init(void)
     }
 }
 
+/* Buzzer sequencer timebase: 1 MHz count, reload set per tick by buzzer.c. */
+static void MX_TIM10_Init(void)
+{
+    htim10.Instance = TIM10;
+    htim10.Init.Prescaler = 83U;    /* 84 MHz / (83+1) = 1 MHz */
+    htim10.Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim10.Init.Period = 999U;
+    htim10.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    htim10.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    if (HAL_TIM_Base_Init(&htim10) != HAL_OK)
+    {
+        Error_Handler();
+    }
+}
+
+/* LED pattern tick: 10 kHz count, update every INDICATOR_TICK_MS. */
+static void MX_TIM11_Init(void)
+{
+    htim11.Instance = TIM11;
+    htim11.Init.Prescaler = 8399U;  /* 84 MHz / (8399+1) = 10 kHz */
+    htim11.Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim11.Init.Period = (INDICATOR_TICK_MS * 10U) - 1U;
+    htim11.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    htim11.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    if (HAL_TIM_Base_Init(&htim11) != HAL_OK)
+    {
+        Error_Handler();
+    }
+}
+
 #if ENABLE_MOTOR_PWM
 static void MX_TIM2_Init(void)
 {
@@ -369,7 +696,6 @@ static void MX_GPIO_Init(void)
     HAL_GPIO_Init(GPIOB, &gpio);
 
 #if ENABLE_BLUETOOTH
-#if !(ENABLE_LCD && LCD_UART2_PA23_SHARED)
     gpio.Pin = HC05_UART_TX_Pin | HC05_UART_RX_Pin;
     gpio.Mode = GPIO_MODE_AF_PP;
     gpio.Pull = GPIO_PULLUP;
@@ -377,7 +703,6 @@ static void MX_GPIO_Init(void)
     gpio.Alternate = GPIO_AF7_USART2;
     HAL_GPIO_Init(GPIOA, &gpio);
 #endif
-#endif
 }
 
 void HAL_ADC_MspInit(ADC_HandleTypeDef *adcHandle)
@@ -393,6 +718,72 @@ void HAL_UART_MspInit(UART_HandleTypeDef *uartHandle)
     if (uartHandle->Instance == USART2)
     {
         __HAL_RCC_USART2_CLK_ENABLE();
+
+        hdma_usart2_tx.Instance = DMA1_Stream6;
+        hdma_usart2_tx.Init.Channel = DMA_CHANNEL_4;
+        hdma_usart2_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+        hdma_usart2_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+        hdma_usart2_tx.Init.MemInc = DMA_MINC_ENABLE;
+        hdma_usart2_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma_usart2_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+        hdma_usart2_tx.Init.Mode = DMA_NORMAL;
+        hdma_usart2_tx.Init.Priority = DMA_PRIORITY_LOW;
+        hdma_usart2_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+        if (HAL_DMA_Init(&hdma_usart2_tx) != HAL_OK)
+        {
+            Error_Handler();
+        }
+        __HAL_LINKDMA(uartHandle, hdmatx, hdma_usart2_tx);
+
+        /* Circular: the receiver never stops, bluetooth.c tracks the write position. */
+        hdma_usart2_rx.Instance = DMA1_Stream5;
+        hdma_usart2_rx.Init.Channel = DMA_CHANNEL_4;
+        hdma_usart2_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+        hdma_usart2_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+        hdma_usart2_rx.Init.MemInc = DMA_MINC_ENABLE;
+        hdma_usart2_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma_usart2_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+        hdma_usart2_rx.Init.Mode = DMA_CIRCULAR;
+        hdma_usart2_rx.Init.Priority = DMA_PRIORITY_MEDIUM;
+        hdma_usart2_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+        if (HAL_DMA_Init(&hdma_usart2_rx) != HAL_OK)
+        {
+            Error_Handler();
+        }
+        __HAL_LINKDMA(uartHandle, hdmarx, hdma_usart2_rx);
+
+        HAL_NVIC_SetPriority(USART2_IRQn, BLUETOOTH_IRQ_PRIORITY, 0U);
+        HAL_NVIC_EnableIRQ(USART2_IRQn);
+    }
+}
+
+void HAL_TIM_Base_MspInit(TIM_HandleTypeDef *tim_baseHandle)
+{
+    if (tim_baseHandle->Instance == TIM10)
+    {
+        __HAL_RCC_TIM10_CLK_ENABLE();
+        HAL_NVIC_SetPriority(TIM1_UP_TIM10_IRQn, BUZZER_IRQ_PRIORITY, 0U);
+        HAL_NVIC_EnableIRQ(TIM1_UP_TIM10_IRQn);
+    }
+    else if (tim_baseHandle->Instance == TIM11)
+    {
+        __HAL_RCC_TIM11_CLK_ENABLE();
+        HAL_NVIC_SetPriority(TIM1_TRG_COM_TIM11_IRQn, INDICATOR_IRQ_PRIORITY, 0U);
+        HAL_NVIC_EnableIRQ(TIM1_TRG_COM_TIM11_IRQn);
+    }
+}
+
+void HAL_TIM_Base_MspDeInit(TIM_HandleTypeDef *tim_baseHandle)
+{
+    if (tim_baseHandle->Instance == TIM10)
+    {
+        HAL_NVIC_DisableIRQ(TIM1_UP_TIM10_IRQn);
+        __HAL_RCC_TIM10_CLK_DISABLE();
+    }
+    else if (tim_baseHandle->Instance == TIM11)
+    {
+        HAL_NVIC_DisableIRQ(TIM1_TRG_COM_TIM11_IRQn);
+        __HAL_RCC_TIM11_CLK_DISABLE();
     }
 }
 
@@ -450,16 +841,15 @@ void HAL_UART_MspDeInit(UART_HandleTypeDef *uartHandle)
 {
     if (uartHandle->Instance == USART2)
     {
+        HAL_NVIC_DisableIRQ(USART2_IRQn);
+        (void)HAL_DMA_DeInit(uartHandle->hdmatx);
+        (void)HAL_DMA_DeInit(uartHandle->hdmarx);
         __HAL_RCC_USART2_CLK_DISABLE();
     }
 }
 
 static void Error_Handler(void)
 {
-    __disable_irq();
-    while (1)
-    {
-        Indicators_BlinkBoth(1U, 150U, 0U);
-        HAL_Delay(150U);
-    }
+    /* SysTick is masked from here on; the fault loop times itself with the DWT. */
+    Indicators_FaultLoop(INDICATOR_FAULT_INIT);
 }
@@ -1,8 +1,14 @@
 #include "motor.h"
 
 #include "app_config.h"
+#include "gpio_out.h"
+#include "gpio_pin.h"
 #include "pin_map.h"
 
+#if DRIVER_BACKEND_LL
+#include "stm32f4xx_ll_tim.h"
+#endif
+
 static TIM_HandleTypeDef *g_left_pwm_timer = NULL;
 static TIM_HandleTypeDef *g_right_pwm_timer = NULL;
 static uint32_t g_left_pwm_channel = 0U;
@@ -11,20 +17,50 @@ static uint8_t g_pwm_ready = 0U;
 static uint8_t g_motor_enabled = 0U;
 static uint8_t g_left_speed_percent = 100U;
 static uint8_t g_right_speed_percent = 100U;
+static int8_t g_left_direction = 0;
+static int8_t g_right_direction = 0;
 
+/* Staged; takes effect at the next GpioOut_Flush(). */
 static void Motor_WriteBridge(GPIO_PinState in1, GPIO_PinState in2, GPIO_PinState in3, GPIO_PinState in4)
 {
-    HAL_GPIO_WritePin(MOTOR_IN1_GPIO_Port, MOTOR_IN1_Pin, in1);
-    HAL_GPIO_WritePin(MOTOR_IN2_GPIO_Port, MOTOR_IN2_Pin, in2);
-    HAL_GPIO_WritePin(MOTOR_IN3_GPIO_Port, MOTOR_IN3_Pin, in3);
-    HAL_GPIO_WritePin(MOTOR_IN4_GPIO_Port, MOTOR_IN4_Pin, in4);
+    uint8_t mask = 0U;
+
+    mask |= (in1 == GPIO_PIN_SET) ? 0x01U : 0U;
+    mask |= (in2 == GPIO_PIN_SET) ? 0x02U : 0U;
+    mask |= (in3 == GPIO_PIN_SET) ? 0x04U : 0U;
+    mask |= (in4 == GPIO_PIN_SET) ? 0x08U : 0U;
+    GpioPin_StageMotorBridge(mask);
 }
 
+#if DRIVER_BACKEND_LL
+static void Motor_ApplyDuty(TIM_HandleTypeDef *htim, uint32_t channel, uint8_t percent)
+{
+    TIM_TypeDef *tim = htim->Instance;
+    uint32_t compare = ((LL_TIM_GetAutoReload(tim) + 1U) * percent) / 100U;
+
+    switch (channel)
+    {
+    case TIM_CHANNEL_1:
+        LL_TIM_OC_SetCompareCH1(tim, compare);
+        break;
+    case TIM_CHANNEL_2:
+        LL_TIM_OC_SetCompareCH2(tim, compare);
+        break;
+    case TIM_CHANNEL_3:
+        LL_TIM_OC_SetCompareCH3(tim, compare);
+        break;
+    default:
+        LL_TIM_OC_SetCompareCH4(tim, compare);
+        break;
+    }
+}
+#else
 static void Motor_ApplyDuty(TIM_HandleTypeDef *htim, uint32_t channel, uint8_t percent)
 {
     uint32_t period = __HAL_TIM_GET_AUTORELOAD(htim) + 1U;
     __HAL_TIM_SET_COMPARE(htim, channel, (period * percent) / 100U);
 }
+#endif
 
 static void Motor_ApplyEnableState(void)
 {
@@ -87,8 +123,8 @@ void Motor_Enable(void)
     g_motor_enabled = 1U;
     Motor_ApplyEnableState();
 #else
-    HAL_GPIO_WritePin(MOTOR_ENA_GPIO_Port, MOTOR_ENA_Pin, GPIO_PIN_SET);
-    HAL_GPIO_WritePin(MOTOR_ENB_GPIO_Port, MOTOR_ENB_Pin, GPIO_PIN_SET);
+    GpioOut_Write(MOTOR_ENA_GPIO_Port, MOTOR_ENA_Pin, 1U);
+    GpioOut_Write(MOTOR_ENB_GPIO_Port, MOTOR_ENB_Pin, 1U);
 #endif
 }
 
@@ -98,8 +134,8 @@ void Motor_Disable(void)
     g_motor_enabled = 0U;
     Motor_ApplyEnableState();
 #else
-    HAL_GPIO_WritePin(MOTOR_ENA_GPIO_Port, MOTOR_ENA_Pin, GPIO_PIN_RESET);
-    HAL_GPIO_WritePin(MOTOR_ENB_GPIO_Port, MOTOR_ENB_Pin, GPIO_PIN_RESET);
+    GpioOut_Write(MOTOR_ENA_GPIO_Port, MOTOR_ENA_Pin, 0U);
+    GpioOut_Write(MOTOR_ENB_GPIO_Port, MOTOR_ENB_Pin, 0U);
 #endif
 }
 
@@ -128,28 +164,67 @@ void Motor_Forward(void)
 {
     Motor_Enable();
     Motor_WriteBridge(GPIO_PIN_SET, GPIO_PIN_RESET, GPIO_PIN_SET, GPIO_PIN_RESET);
+    g_left_direction = 1;
+    g_right_direction = 1;
 }
 
 void Motor_Backward(void)
 {
     Motor_Enable();
     Motor_WriteBridge(GPIO_PIN_RESET, GPIO_PIN_SET, GPIO_PIN_RESET, GPIO_PIN_SET);
+    g_left_direction = -1;
+    g_right_direction = -1;
 }
 
 void Motor_TurnLeftInPlace(void)
 {
     Motor_Enable();
     Motor_WriteBridge(GPIO_PIN_RESET, GPIO_PIN_SET, GPIO_PIN_SET, GPIO_PIN_RESET);
+    g_left_direction = -1;
+    g_right_direction = 1;
 }
 
 void Motor_TurnRightInPlace(void)
 {
     Motor_Enable();
     Motor_WriteBridge(GPIO_PIN_SET, GPIO_PIN_RESET, GPIO_PIN_RESET, GPIO_PIN_SET);
+    g_left_direction = 1;
+    g_right_direction = -1;
 }
 
 void Motor_Stop(void)
 {
     Motor_WriteBridge(GPIO_PIN_RESET, GPIO_PIN_RESET, GPIO_PIN_RESET, GPIO_PIN_RESET);
     Motor_Disable();
+    /* A stop is not deferred to the end of the cycle. */
+    GpioOut_Flush();
+    g_left_direction = 0;
+    g_right_direction = 0;
+}
+
+/* Signed duty per wheel as currently commanded (+ forward, - backward). */
+void Motor_GetCommand(int8_t *left_percent, int8_t *right_percent)
+{
+    uint8_t left = g_left_speed_percent;
+    uint8_t right = g_right_speed_percent;
+
+#if ENABLE_MOTOR_PWM
+    if (g_motor_enabled == 0U)
+    {
+        left = 0U;
+        right = 0U;
+    }
+#else
+    left = 100U;
+    right = 100U;
+#endif
+
+    if (left_percent != NULL)
+    {
+        *left_percent = (int8_t)(g_left_direction * (int8_t)left);
+    }
+    if (right_percent != NULL)
+    {
+        *right_percent = (int8_t)(g_right_direction * (int8_t)right);
+    }
 }
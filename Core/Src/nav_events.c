@@ -0,0 +1,266 @@
+#include "nav_events.h"
+
+#include <stddef.h>
+
+#include "app_config.h"
+#include "cycle_counter.h"
+
+#if ENABLE_RTOS
+#include "cmsis_os2.h"
+#endif
+
+/*
+ * Navigation event queue. SysTick posts the periodic sample and the action
+ * deadline; the navigation thread posts the edges it derives from a sample;
+ * UART reception may post commands. Only one SAMPLE and one DEADLINE can be
+ * pending at a time, so a slow consumer sees the latest state once instead
+ * of a backlog of stale samples. In the RTOS build the sensor thread posts
+ * the sample, and the control thread blocks on an event flag with the
+ * deadline as its timeout.
+ */
+
+#define NAV_EVENT_QUEUE_MASK (NAV_EVENT_QUEUE_CAPACITY - 1U)
+
+#if (NAV_EVENT_QUEUE_CAPACITY == 0U) || ((NAV_EVENT_QUEUE_CAPACITY & (NAV_EVENT_QUEUE_CAPACITY - 1U)) != 0U)
+#error "NAV_EVENT_QUEUE_CAPACITY must be a power of two"
+#endif
+
+static NavEvent g_event_queue[NAV_EVENT_QUEUE_CAPACITY];
+static volatile uint8_t g_event_head = 0U;
+static volatile uint8_t g_event_count = 0U;
+
+static volatile uint8_t g_event_sample_pending = 0U;
+static volatile uint32_t g_event_last_sample_ms = 0U;
+static volatile uint8_t g_event_deadline_armed = 0U;
+static volatile uint32_t g_event_deadline_ms = 0U;
+
+static const char *const kNavEventNames[NAV_EVENT_TYPE_COUNT] =
+{
+    "sample",
+    "edge",
+    "mark",
+    "deadline",
+    "command"
+};
+
+static NavLatencyStats g_event_latency[NAV_EVENT_TYPE_COUNT];
+static NavEventStats g_event_stats;
+
+#if ENABLE_RTOS
+#define NAV_EVENTS_FLAG_PENDING 0x0001U
+static osEventFlagsId_t g_event_flags = NULL;
+#endif
+
+void NavEvents_Init(void)
+{
+    uint8_t i;
+
+    g_event_head = 0U;
+    g_event_count = 0U;
+    g_event_sample_pending = 0U;
+    g_event_deadline_armed = 0U;
+
+    for (i = 0U; i < (uint8_t)NAV_EVENT_TYPE_COUNT; ++i)
+    {
+        g_event_latency[i].count = 0U;
+        g_event_latency[i].last_us = 0U;
+        g_event_latency[i].max_us = 0U;
+        g_event_latency[i].total_us = 0U;
+    }
+    g_event_stats.dropped = 0U;
+    g_event_stats.skipped_samples = 0U;
+
+#if ENABLE_RTOS
+    if (g_event_flags == NULL)
+    {
+        g_event_flags = osEventFlagsNew(NULL);
+    }
+#endif
+}
+
+uint8_t NavEvents_Post(NavEventType type, uint8_t arg, uint32_t stamp_cycles)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint8_t ok = 0U;
+    uint8_t queued = 0U;
+
+    __disable_irq();
+    if ((type == NAV_EVENT_SAMPLE) && (g_event_sample_pending != 0U))
+    {
+        ok = 1U;
+    }
+    else if (g_event_count < NAV_EVENT_QUEUE_CAPACITY)
+    {
+        NavEvent *slot = &g_event_queue[(g_event_head + g_event_count) & NAV_EVENT_QUEUE_MASK];
+        slot->type = (uint8_t)type;
+        slot->arg = arg;
+        slot->stamp_cycles = stamp_cycles;
+        ++g_event_count;
+        if (type == NAV_EVENT_SAMPLE)
+        {
+            g_event_sample_pending = 1U;
+        }
+        ok = 1U;
+        queued = 1U;
+    }
+    else
+    {
+        ++g_event_stats.dropped;
+    }
+    __set_PRIMASK(primask);
+
+#if ENABLE_RTOS
+    if ((queued != 0U) && (g_event_flags != NULL))
+    {
+        (void)osEventFlagsSet(g_event_flags, NAV_EVENTS_FLAG_PENDING);
+    }
+#else
+    (void)queued;
+#endif
+
+    return ok;
+}
+
+uint8_t NavEvents_Pop(NavEvent *event)
+{
+    uint32_t primask;
+    uint8_t ok = 0U;
+
+    if (event == NULL)
+    {
+        return 0U;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (g_event_count != 0U)
+    {
+        *event = g_event_queue[g_event_head];
+        g_event_head = (uint8_t)((g_event_head + 1U) & NAV_EVENT_QUEUE_MASK);
+        --g_event_count;
+        if (event->type == (uint8_t)NAV_EVENT_SAMPLE)
+        {
+            g_event_sample_pending = 0U;
+        }
+        ok = 1U;
+    }
+    __set_PRIMASK(primask);
+
+    return ok;
+}
+
+uint8_t NavEvents_HasPending(void)
+{
+    return (uint8_t)(g_event_count != 0U);
+}
+
+static void NavEvents_CheckDeadline(uint32_t now_ms)
+{
+    if ((g_event_deadline_armed != 0U) && ((int32_t)(now_ms - g_event_deadline_ms) >= 0))
+    {
+        g_event_deadline_armed = 0U;
+        (void)NavEvents_Post(NAV_EVENT_ACTION_DEADLINE, 0U, CycleCounter_Now());
+    }
+}
+
+void NavEvents_OnTick(uint32_t now_ms)
+{
+    if ((now_ms - g_event_last_sample_ms) >= NAV_SAMPLE_PERIOD_MS)
+    {
+        g_event_last_sample_ms = now_ms;
+        (void)NavEvents_Post(NAV_EVENT_SAMPLE, 0U, CycleCounter_Now());
+    }
+
+    NavEvents_CheckDeadline(now_ms);
+}
+
+void NavEvents_ArmDeadline(uint32_t deadline_ms)
+{
+    g_event_deadline_armed = 0U;
+    g_event_deadline_ms = deadline_ms;
+    g_event_deadline_armed = 1U;
+}
+
+void NavEvents_CancelDeadline(void)
+{
+    g_event_deadline_armed = 0U;
+}
+
+void NavEvents_WaitForEvent(void)
+{
+#if ENABLE_RTOS
+    uint32_t timeout = osWaitForever;
+
+    if (g_event_count != 0U)
+    {
+        return;
+    }
+
+    /* The flag stays set if an event arrives between the check and the wait. */
+    if (g_event_deadline_armed != 0U)
+    {
+        int32_t remaining_ms = (int32_t)(g_event_deadline_ms - HAL_GetTick());
+        timeout = (remaining_ms > 0) ? (((uint32_t)remaining_ms * osKernelGetTickFreq()) / 1000U) : 0U;
+    }
+
+    (void)osEventFlagsWait(g_event_flags, NAV_EVENTS_FLAG_PENDING, osFlagsWaitAny, timeout);
+    NavEvents_CheckDeadline(HAL_GetTick());
+#else
+    /* WFI still wakes on an interrupt that becomes pending while PRIMASK is set. */
+    __disable_irq();
+    if (g_event_count == 0U)
+    {
+        __WFI();
+    }
+    __enable_irq();
+#endif
+}
+
+void NavEvents_RecordLatency(const NavEvent *event, uint32_t now_cycles)
+{
+    NavLatencyStats *stats;
+    uint32_t us;
+
+    if ((event == NULL) || (event->type >= (uint8_t)NAV_EVENT_TYPE_COUNT))
+    {
+        return;
+    }
+
+    stats = &g_event_latency[event->type];
+    us = CycleCounter_ToMicros(now_cycles - event->stamp_cycles);
+    ++stats->count;
+    stats->last_us = us;
+    stats->total_us += us;
+    if (us > stats->max_us)
+    {
+        stats->max_us = us;
+    }
+}
+
+void NavEvents_CountSkippedSample(void)
+{
+    ++g_event_stats.skipped_samples;
+}
+
+const NavLatencyStats *NavEvents_GetLatency(NavEventType type)
+{
+    if (type >= NAV_EVENT_TYPE_COUNT)
+    {
+        return NULL;
+    }
+    return &g_event_latency[type];
+}
+
+const NavEventStats *NavEvents_GetStats(void)
+{
+    return &g_event_stats;
+}
+
+const char *NavEvents_GetTypeName(NavEventType type)
+{
+    if (type >= NAV_EVENT_TYPE_COUNT)
+    {
+        return NULL;
+    }
+    return kNavEventNames[type];
+}
@@ -2,10 +2,22 @@
 
 #include "app_config.h"
 #include "buzzer.h"
+#include "cycle_counter.h"
+#include "gpio_out.h"
+#include "host_cmd.h"
 #include "indicators.h"
 #include "motor.h"
+#include "nav_events.h"
+#include "occupancy_grid.h"
+#include "param_store.h"
+#include "pose.h"
+#include "route_memory.h"
+#include "scan_profile.h"
 #include "sensors.h"
 #include "seven_seg.h"
+#include "speed_model.h"
+#include "steering.h"
+#include "turn_calib.h"
 
 typedef enum
 {
@@ -13,31 +25,156 @@ typedef enum
     COUNT_MODE_DOWN = 1
 } CountMode;
 
+/* PLAN: scene and escape steps; SAFETY: guard stops; CRITICAL: front edge and host stop. */
 typedef enum
 {
-    ACTION_NONE = 0,
-    ACTION_PAUSE,
-    ACTION_REVERSE,
-    ACTION_BACKOFF,
-    ACTION_TURN_LEFT_90,
-    ACTION_TURN_RIGHT_90,
-    ACTION_U_TURN_180
-} ActionType;
+    ACTION_PRIORITY_PLAN = 0,
+    ACTION_PRIORITY_SAFETY = 1,
+    ACTION_PRIORITY_CRITICAL = 2
+} ActionPriority;
 
+/* What a preemption does with the interrupted action and the queued plan. */
+typedef enum
+{
+    NAV_PLAN_RESUME = 0,
+    NAV_PLAN_DISCARD = 1
+} NavPlanPolicy;
+
+typedef enum
+{
+    SCAN_PHASE_SWEEP_RIGHT = 0,
+    SCAN_PHASE_SWEEP_LEFT = 1,
+    SCAN_PHASE_ALIGN = 2
+} ScanPhase;
+
+typedef enum
+{
+    STALL_NONE = 0,
+    STALL_NO_PROGRESS = 1,
+    STALL_OSCILLATION = 2
+} StallKind;
+
+/* One entry per replan, for the progress monitor. */
+typedef struct
+{
+    uint32_t at_ms;
+    int32_t x_mm;
+    int32_t y_mm;
+    uint8_t scene;
+} ReplanRecord;
+
+typedef enum
+{
+    GUARD_CONTINUE = 0,
+    GUARD_ABORT = 1
+} GuardVerdict;
+
+/*
+ * duration_ms is the full length of a timed action and the timeout backstop of
+ * a predicate action; min_ms keeps turns from ending on the first gap they see.
+ * Turn predicates are edge-triggered: the watched side has to read blocked at
+ * some point of the turn before "clear" ends it, otherwise the turn times out.
+ */
 typedef struct
 {
-    ActionType type;
+    NavActionType type;
+    ActionPriority priority;
+    NavUntil until;
+    uint16_t until_cm;
+    uint32_t min_ms;
     uint32_t duration_ms;
 } TimedAction;
 
-#define ACTION_QUEUE_CAPACITY 6U
+typedef struct
+{
+    const NavPlanStep *steps;
+    uint8_t count;
+} ScenePlan;
+
+/* Flash-resident plan tables; constexpr in the C++ (MDK-ARM/main.cpp) build. */
+#if defined(__cplusplus)
+#define NAV_PLAN_TABLE static constexpr
+#else
+#define NAV_PLAN_TABLE static const
+#endif
+
+#define NAV_PLAN_LENGTH(steps) ((uint8_t)(sizeof(steps) / sizeof((steps)[0])))
+
+/*
+ * Set A: requirement-sheet maneuvers, ended by sensors where that is safe.
+ * The U-turn stays timed so scene 5 retraces the marks it counted on the way in.
+ */
+NAV_PLAN_TABLE NavPlanStep kPlanAScene2[] =
+{
+    {NAV_ACTION_PAUSE, NAV_UNTIL_TIMEOUT, NAV_STEP_DEFAULT_CLEARANCE, NAV_STEP_DEFAULT_DURATION},
+    {NAV_ACTION_REVERSE, NAV_UNTIL_FRONT_CLEAR, NAV_STEP_DEFAULT_CLEARANCE, NAV_STEP_DEFAULT_DURATION},
+    {NAV_ACTION_TURN_ALTERNATE_90, NAV_UNTIL_FRONT_CLEAR, NAV_STEP_DEFAULT_CLEARANCE, NAV_STEP_DEFAULT_DURATION}
+};
+NAV_PLAN_TABLE NavPlanStep kPlanAScene3[] =
+{
+    {NAV_ACTION_BACKOFF, NAV_UNTIL_FRONT_CLEAR, NAV_STEP_DEFAULT_CLEARANCE, NAV_STEP_DEFAULT_DURATION},
+    {NAV_ACTION_TURN_RIGHT_90, NAV_UNTIL_FRONT_CLEAR, NAV_STEP_DEFAULT_CLEARANCE, NAV_STEP_DEFAULT_DURATION}
+};
+NAV_PLAN_TABLE NavPlanStep kPlanAScene4[] =
+{
+    {NAV_ACTION_BACKOFF, NAV_UNTIL_FRONT_CLEAR, NAV_STEP_DEFAULT_CLEARANCE, NAV_STEP_DEFAULT_DURATION},
+    {NAV_ACTION_TURN_LEFT_90, NAV_UNTIL_FRONT_CLEAR, NAV_STEP_DEFAULT_CLEARANCE, NAV_STEP_DEFAULT_DURATION}
+};
+NAV_PLAN_TABLE NavPlanStep kPlanAScene5[] =
+{
+    {NAV_ACTION_BACKOFF, NAV_UNTIL_FRONT_CLEAR, NAV_STEP_DEFAULT_CLEARANCE, NAV_STEP_DEFAULT_DURATION},
+    {NAV_ACTION_U_TURN_180, NAV_UNTIL_TIMEOUT, NAV_STEP_DEFAULT_CLEARANCE, NAV_STEP_DEFAULT_DURATION}
+};
+
+/* Set B: shorter scene 2 (no pause, short backoff), longer reverse before the U-turn. */
+NAV_PLAN_TABLE NavPlanStep kPlanBScene2[] =
+{
+    {NAV_ACTION_BACKOFF, NAV_UNTIL_FRONT_CLEAR, NAV_STEP_DEFAULT_CLEARANCE, NAV_STEP_DEFAULT_DURATION},
+    {NAV_ACTION_TURN_ALTERNATE_90, NAV_UNTIL_FRONT_CLEAR, NAV_STEP_DEFAULT_CLEARANCE, NAV_STEP_DEFAULT_DURATION}
+};
+NAV_PLAN_TABLE NavPlanStep kPlanBScene5[] =
+{
+    {NAV_ACTION_REVERSE, NAV_UNTIL_FRONT_CLEAR, NAV_STEP_DEFAULT_CLEARANCE, NAV_STEP_DEFAULT_DURATION},
+    {NAV_ACTION_U_TURN_180, NAV_UNTIL_TIMEOUT, NAV_STEP_DEFAULT_CLEARANCE, NAV_STEP_DEFAULT_DURATION}
+};
+
+/* Indexed by [PARAM_PLAN_SET][scene - NAV_SCENE_2_FRONT_ONLY]. */
+NAV_PLAN_TABLE ScenePlan kScenePlans[NAV_PLAN_SET_COUNT][4] =
+{
+    {
+        {kPlanAScene2, NAV_PLAN_LENGTH(kPlanAScene2)},
+        {kPlanAScene3, NAV_PLAN_LENGTH(kPlanAScene3)},
+        {kPlanAScene4, NAV_PLAN_LENGTH(kPlanAScene4)},
+        {kPlanAScene5, NAV_PLAN_LENGTH(kPlanAScene5)}
+    },
+    {
+        {kPlanBScene2, NAV_PLAN_LENGTH(kPlanBScene2)},
+        {kPlanAScene3, NAV_PLAN_LENGTH(kPlanAScene3)},
+        {kPlanAScene4, NAV_PLAN_LENGTH(kPlanAScene4)},
+        {kPlanBScene5, NAV_PLAN_LENGTH(kPlanBScene5)}
+    }
+};
 
+#define NAV_HALF_PI 1.57079633f
+
+#define ACTION_QUEUE_CAPACITY NAV_ACTION_QUEUE_CAPACITY
+#define ACTION_QUEUE_MASK     (ACTION_QUEUE_CAPACITY - 1U)
+
+#if (NAV_ACTION_QUEUE_CAPACITY == 0U) || ((NAV_ACTION_QUEUE_CAPACITY & (NAV_ACTION_QUEUE_CAPACITY - 1U)) != 0U)
+#error "NAV_ACTION_QUEUE_CAPACITY must be a power of two"
+#endif
+
+/* Ring buffer: g_action_head indexes the next action to run. */
 static TimedAction g_action_queue[ACTION_QUEUE_CAPACITY];
+static uint8_t g_action_head = 0U;
 static uint8_t g_action_count = 0U;
 
 static TimedAction g_active_action;
 static uint8_t g_active_action_valid = 0U;
 static uint32_t g_active_action_start_ms = 0U;
+static uint8_t g_active_start_left_blocked = 0U;
+static uint8_t g_active_start_right_blocked = 0U;
+static uint8_t g_active_goal_armed = 0U;
 
 static uint8_t g_counter = 0U;
 static CountMode g_count_mode = COUNT_MODE_UP;
@@ -45,48 +182,224 @@ static NavSceneId g_scene = NAV_SCENE_1_CLEAR_FORWARD;
 static NavMotion g_motion = NAV_MOTION_STOP;
 
 static uint8_t g_halted = 0U;
+static uint8_t g_host_stopped = 0U; /* halted by a host "stop", not by completing the run */
 static uint8_t g_scene5_countdown_mode = 0U;
 static uint8_t g_scene2_turn_toggle = 0U;
 static uint8_t g_last_front_blocked = 0U;
+static uint8_t g_mark_edge_pending = 0U;
+static uint8_t g_last_blocked_mask = 0U;
+static SensorSnapshot g_decided_snapshot;
+static NavStats g_nav_stats;
+
+static ScanPhase g_scan_phase = SCAN_PHASE_SWEEP_RIGHT;
+static float g_scan_target_rad = 0.0f;
+
+static ReplanRecord g_replan_history[NAV_STALL_HISTORY];
+static uint8_t g_replan_head = 0U;
+static uint8_t g_replan_count = 0U;
+
+static void StartNextActionIfIdle(void);
 
 static void ActionQueue_Clear(void)
 {
+    g_action_head = 0U;
     g_action_count = 0U;
 }
 
-static uint8_t ActionQueue_Push(ActionType type, uint32_t duration_ms)
+static uint8_t ActionQueue_Push(const TimedAction *action)
 {
     if (g_action_count >= ACTION_QUEUE_CAPACITY)
     {
         return 0U;
     }
 
-    g_action_queue[g_action_count].type = type;
-    g_action_queue[g_action_count].duration_ms = duration_ms;
+    g_action_queue[(g_action_head + g_action_count) & ACTION_QUEUE_MASK] = *action;
     ++g_action_count;
     return 1U;
 }
 
-static uint8_t ActionQueue_Pop(TimedAction *action)
+static uint8_t ActionQueue_PushFront(const TimedAction *action)
 {
-    uint8_t i;
+    if (g_action_count >= ACTION_QUEUE_CAPACITY)
+    {
+        return 0U;
+    }
 
+    g_action_head = (uint8_t)((g_action_head - 1U) & ACTION_QUEUE_MASK);
+    g_action_queue[g_action_head] = *action;
+    ++g_action_count;
+    return 1U;
+}
+
+static uint8_t ActionQueue_Pop(TimedAction *action)
+{
     if ((action == NULL) || (g_action_count == 0U))
     {
         return 0U;
     }
 
-    *action = g_action_queue[0];
+    *action = g_action_queue[g_action_head];
+    g_action_head = (uint8_t)((g_action_head + 1U) & ACTION_QUEUE_MASK);
+    --g_action_count;
+    return 1U;
+}
 
-    for (i = 1U; i < g_action_count; ++i)
+/*
+ * Drops queued actions below the given priority and keeps the order of the rest.
+ * Only used on replans, so the linear compaction stays off the per-cycle path.
+ */
+static void ActionQueue_DiscardBelow(ActionPriority priority)
+{
+    uint8_t read;
+    uint8_t kept = 0U;
+
+    for (read = 0U; read < g_action_count; ++read)
     {
-        g_action_queue[i - 1U] = g_action_queue[i];
+        const TimedAction *action = &g_action_queue[(g_action_head + read) & ACTION_QUEUE_MASK];
+        if (action->priority >= priority)
+        {
+            g_action_queue[(g_action_head + kept) & ACTION_QUEUE_MASK] = *action;
+            ++kept;
+        }
     }
 
-    --g_action_count;
+    g_action_count = kept;
+}
+
+/*
+ * Frees `needed` slots by dropping queued actions below `priority`, lowest
+ * priority first and from the tail of the plan. Returns 0 when the rest of
+ * the queue outranks the caller and there is still no room.
+ */
+static uint8_t ActionQueue_MakeRoom(uint8_t needed, ActionPriority priority)
+{
+    uint8_t level;
+
+    for (level = (uint8_t)ACTION_PRIORITY_PLAN; level < (uint8_t)priority; ++level)
+    {
+        uint8_t index = g_action_count;
+
+        while ((index > 0U) && ((g_action_count + needed) > ACTION_QUEUE_CAPACITY))
+        {
+            uint8_t next;
+
+            --index;
+            if ((uint8_t)g_action_queue[(g_action_head + index) & ACTION_QUEUE_MASK].priority != level)
+            {
+                continue;
+            }
+            for (next = (uint8_t)(index + 1U); next < g_action_count; ++next)
+            {
+                g_action_queue[(g_action_head + next - 1U) & ACTION_QUEUE_MASK] =
+                    g_action_queue[(g_action_head + next) & ACTION_QUEUE_MASK];
+            }
+            --g_action_count;
+            ++g_nav_stats.preempt_drops;
+        }
+    }
+
+    return ((g_action_count + needed) <= ACTION_QUEUE_CAPACITY) ? 1U : 0U;
+}
+
+/*
+ * Interrupts the active action with a higher-priority maneuver.
+ * PLAN_RESUME re-queues the unfinished part of the interrupted action behind the
+ * maneuver, so the plan continues where it stopped; PLAN_DISCARD drops the plan.
+ * The interrupted action is not finished: the maneuver takes over the motors
+ * and the deadline. A full queue loses its lowest-priority tail; if that is not
+ * enough the preemption is refused and counted, the plan left as it was.
+ */
+static uint8_t ActionQueue_Preempt(
+    NavActionType type,
+    uint32_t duration_ms,
+    ActionPriority priority,
+    NavPlanPolicy policy)
+{
+    TimedAction maneuver;
+    TimedAction remainder;
+    uint8_t keep_remainder = 0U;
+
+    if (g_halted != 0U)
+    {
+        return 0U;
+    }
+
+    if ((g_active_action_valid != 0U) && (priority <= g_active_action.priority))
+    {
+        return 0U;
+    }
+
+    if (policy == NAV_PLAN_DISCARD)
+    {
+        ActionQueue_DiscardBelow(priority);
+    }
+    else if (g_active_action_valid != 0U)
+    {
+        uint32_t elapsed = HAL_GetTick() - g_active_action_start_ms;
+        if (elapsed < g_active_action.duration_ms)
+        {
+            remainder = g_active_action;
+            /* A scan restarts its sweep, so it gets its full time again. */
+            if (remainder.type != NAV_ACTION_SCAN)
+            {
+                remainder.duration_ms -= elapsed;
+                remainder.min_ms = (remainder.min_ms > elapsed) ? (remainder.min_ms - elapsed) : 0U;
+            }
+            keep_remainder = 1U;
+        }
+    }
+
+    if (ActionQueue_MakeRoom((uint8_t)(keep_remainder + 1U), priority) == 0U)
+    {
+        ++g_nav_stats.preempt_refused;
+        return 0U;
+    }
+
+    if (keep_remainder != 0U)
+    {
+        (void)ActionQueue_PushFront(&remainder);
+    }
+
+    maneuver.type = type;
+    maneuver.priority = priority;
+    maneuver.until = NAV_UNTIL_TIMEOUT;
+    maneuver.until_cm = 0U;
+    maneuver.min_ms = 0U;
+    maneuver.duration_ms = duration_ms;
+    (void)ActionQueue_PushFront(&maneuver);
+
+    g_active_action_valid = 0U;
+    StartNextActionIfIdle();
     return 1U;
 }
 
+static void ClearParamSaveFault(void)
+{
+    if (Indicators_GetFault() == INDICATOR_FAULT_PARAM_SAVE)
+    {
+        Indicators_ClearFault();
+    }
+}
+
+#if ENABLE_PARAM_FLASH
+static void SaveDirtyParams(void)
+{
+    if (ParamStore_IsDirty() == 0U)
+    {
+        return;
+    }
+
+    if (ParamStore_Save() != 0U)
+    {
+        ClearParamSaveFault();
+    }
+    else
+    {
+        Indicators_ShowFault(INDICATOR_FAULT_PARAM_SAVE);
+    }
+}
+#endif
+
 static void StopWithCompleteSignal(void)
 {
     g_halted = 1U;
@@ -95,19 +408,29 @@ static void StopWithCompleteSignal(void)
     g_motion = NAV_MOTION_STOP;
 
     Motor_Stop();
+
+#if ENABLE_PARAM_FLASH
+    /* Learned turn durations are written once the car stands still. */
+    SaveDirtyParams();
+#endif
+
     SevenSeg_ShowNumber(g_counter);
-    Buzzer_BeepPattern(2U, BEEP_DONE_ON_MS, BEEP_DONE_OFF_MS);
-    Indicators_BlinkBoth(2U, 80U, 80U);
+    (void)Buzzer_BeepPattern(2U, BEEP_DONE_ON_MS, BEEP_DONE_OFF_MS);
+    /* Ignored while a fault code owns the LEDs. */
+    (void)Indicators_Blink(INDICATOR_LED_BOTH, 2U, 80U, 80U);
 }
 
 static void HandleMarkEvent(void)
 {
-    if (Sensors_ConsumeMarkEdge() == 0U)
+    if (g_mark_edge_pending == 0U)
     {
         return;
     }
+    g_mark_edge_pending = 0U;
 
-    Buzzer_BeepBlocking(BEEP_MARK_MS);
+    (void)Buzzer_Beep(BEEP_MARK_MS);
+    Pose_OnMark();
+    RouteMemory_OnMark(HAL_GetTick());
 
     if (g_count_mode == COUNT_MODE_UP)
     {
@@ -136,43 +459,60 @@ static void HandleFrontObstacleEdge(const SensorSnapshot *snapshot)
 {
     if ((snapshot->front_blocked != 0U) && (g_last_front_blocked == 0U))
     {
-        Buzzer_BeepBlocking(BEEP_OBSTACLE_MS);
+        (void)Buzzer_Beep(BEEP_OBSTACLE_MS);
+
+        /*
+         * New obstacle while driving forward: stop before the scene logic runs.
+         * Maneuvers turn in place or back away, so they keep going.
+         */
+        if ((g_active_action_valid == 0U) && (g_motion == NAV_MOTION_FORWARD))
+        {
+            (void)ActionQueue_Preempt(NAV_ACTION_PAUSE, 0U, ACTION_PRIORITY_CRITICAL, NAV_PLAN_DISCARD);
+        }
     }
 
     g_last_front_blocked = snapshot->front_blocked;
 }
 
-static void ApplyAction(ActionType type)
+static void ApplyAction(NavActionType type)
 {
     switch (type)
     {
-    case ACTION_PAUSE:
+    case NAV_ACTION_PAUSE:
         g_motion = NAV_MOTION_STOP;
         Motor_SetSpeed(0U, 0U);
         Motor_Stop();
         break;
 
-    case ACTION_REVERSE:
-    case ACTION_BACKOFF:
+    case NAV_ACTION_REVERSE:
+    case NAV_ACTION_BACKOFF:
         g_motion = NAV_MOTION_BACKWARD;
         Motor_SetSpeed(MOTOR_SPEED_REVERSE_PERCENT, MOTOR_SPEED_REVERSE_PERCENT);
         Motor_Backward();
         g_count_mode = COUNT_MODE_DOWN;
         break;
 
-    case ACTION_TURN_LEFT_90:
+    case NAV_ACTION_TURN_LEFT_90:
         g_motion = NAV_MOTION_TURN_LEFT;
         Motor_SetSpeed(MOTOR_SPEED_TURN_PERCENT, MOTOR_SPEED_TURN_PERCENT);
         Motor_TurnLeftInPlace();
         break;
 
-    case ACTION_TURN_RIGHT_90:
-    case ACTION_U_TURN_180:
+    case NAV_ACTION_TURN_RIGHT_90:
+    case NAV_ACTION_U_TURN_180:
         g_motion = NAV_MOTION_TURN_RIGHT;
         Motor_SetSpeed(MOTOR_SPEED_TURN_PERCENT, MOTOR_SPEED_TURN_PERCENT);
         Motor_TurnRightInPlace();
         break;
 
+    case NAV_ACTION_SCAN:
+        ScanProfile_Begin(Pose_GetHeadingRad());
+        g_scan_phase = SCAN_PHASE_SWEEP_RIGHT;
+        g_motion = NAV_MOTION_TURN_RIGHT;
+        Motor_SetSpeed(SCAN_TURN_PERCENT, SCAN_TURN_PERCENT);
+        Motor_TurnRightInPlace();
+        break;
+
     default:
         g_motion = NAV_MOTION_STOP;
         Motor_SetSpeed(0U, 0U);
@@ -180,7 +520,7 @@ static void ApplyAction(ActionType type)
         break;
     }
 
-    if ((type != ACTION_REVERSE) && (type != ACTION_BACKOFF))
+    if ((type != NAV_ACTION_REVERSE) && (type != NAV_ACTION_BACKOFF))
     {
         if (g_scene5_countdown_mode != 0U)
         {
@@ -193,6 +533,13 @@ static void ApplyAction(ActionType type)
     }
 }
 
+static uint8_t IsTurnAction(NavActionType type)
+{
+    return (uint8_t)((type == NAV_ACTION_TURN_LEFT_90) ||
+                     (type == NAV_ACTION_TURN_RIGHT_90) ||
+                     (type == NAV_ACTION_U_TURN_180));
+}
+
 static void StartNextActionIfIdle(void)
 {
     if ((g_halted != 0U) || (g_active_action_valid != 0U))
@@ -207,107 +554,726 @@ static void StartNextActionIfIdle(void)
 
     g_active_action_valid = 1U;
     g_active_action_start_ms = HAL_GetTick();
+    g_active_start_left_blocked = Sensors_GetSnapshot()->left_blocked;
+    g_active_start_right_blocked = Sensors_GetSnapshot()->right_blocked;
+    g_active_goal_armed = (IsTurnAction(g_active_action.type) != 0U) ? 0U : 1U;
+    NavEvents_ArmDeadline(g_active_action_start_ms + g_active_action.duration_ms);
+    TurnCalib_OnTurnStart(g_active_action.type, g_active_action.duration_ms, Sensors_GetSnapshot());
     ApplyAction(g_active_action.type);
 }
 
-static void ProcessActiveAction(void)
+static void FinishActiveAction(void)
+{
+    NavEvents_CancelDeadline();
+    g_active_action_valid = 0U;
+    g_motion = NAV_MOTION_STOP;
+    Motor_Stop();
+}
+
+static uint8_t IsActionGoalReached(const SensorSnapshot *snapshot)
+{
+    switch (g_active_action.until)
+    {
+    case NAV_UNTIL_FRONT_CLEAR:
+        return (snapshot->front_cm > g_active_action.until_cm) ? 1U : 0U;
+    case NAV_UNTIL_LEFT_CLEAR:
+        return (snapshot->left_cm > g_active_action.until_cm) ? 1U : 0U;
+    case NAV_UNTIL_RIGHT_CLEAR:
+        return (snapshot->right_cm > g_active_action.until_cm) ? 1U : 0U;
+    default:
+        return 0U;
+    }
+}
+
+static void RecordScanBranch(float offset_rad)
+{
+    NavPose pose;
+    RouteTurn turn = ROUTE_TURN_NONE;
+
+    if (offset_rad > 0.0f)
+    {
+        turn = ROUTE_TURN_LEFT;
+    }
+    else if (offset_rad < 0.0f)
+    {
+        turn = ROUTE_TURN_RIGHT;
+    }
+
+    Pose_Get(&pose);
+    RouteMemory_OnBranch(g_counter, &pose, HAL_GetTick(), turn);
+}
+
+/*
+ * Scan phases, all measured in the pose frame so a heading scale error of the
+ * estimator cancels between sweep and alignment: sweep right to the arc edge,
+ * sweep left across the whole arc, then turn back right to the best bin.
+ * Returns 1 once the scan is done.
+ */
+static uint8_t ProcessScan(const SensorSnapshot *snapshot)
+{
+    const float half_arc_rad = (float)SCAN_ARC_DEG * (NAV_HALF_PI / 180.0f);
+    float heading = Pose_GetHeadingRad();
+    float offset = ScanProfile_Offset(heading);
+    float best;
+
+    switch (g_scan_phase)
+    {
+    case SCAN_PHASE_SWEEP_RIGHT:
+        ScanProfile_AddSample(heading, snapshot->front_cm);
+        if (offset <= -half_arc_rad)
+        {
+            g_scan_phase = SCAN_PHASE_SWEEP_LEFT;
+            g_motion = NAV_MOTION_TURN_LEFT;
+            Motor_TurnLeftInPlace();
+        }
+        return 0U;
+
+    case SCAN_PHASE_SWEEP_LEFT:
+        ScanProfile_AddSample(heading, snapshot->front_cm);
+        if (offset < half_arc_rad)
+        {
+            return 0U;
+        }
+
+        ++g_nav_stats.scans;
+        if (ScanProfile_GetBestOffset(ParamStore_Get(PARAM_CLEAR_DISTANCE_CM), &best) == 0U)
+        {
+            /* Nothing open in the arc: stop here and let the scene logic replan. */
+            ++g_nav_stats.scan_no_opening;
+            return 1U;
+        }
+
+        RecordScanBranch(best);
+        g_scan_target_rad = best;
+        g_scan_phase = SCAN_PHASE_ALIGN;
+        g_motion = NAV_MOTION_TURN_RIGHT;
+        Motor_TurnRightInPlace();
+        return 0U;
+
+    default:
+        return (offset <= g_scan_target_rad) ? 1U : 0U;
+    }
+}
+
+static void ProcessActiveAction(const SensorSnapshot *snapshot)
 {
-    uint32_t now;
+    uint32_t elapsed;
+    uint8_t goal_reached;
 
     if (g_active_action_valid == 0U)
     {
         return;
     }
 
-    now = HAL_GetTick();
-    if ((now - g_active_action_start_ms) < g_active_action.duration_ms)
+    elapsed = HAL_GetTick() - g_active_action_start_ms;
+    TurnCalib_OnTurnSample(snapshot);
+
+    if ((g_active_action.type == NAV_ACTION_SCAN) && (ProcessScan(snapshot) != 0U))
     {
+        FinishActiveAction();
         return;
     }
 
-    g_active_action_valid = 0U;
-    g_motion = NAV_MOTION_STOP;
-    Motor_Stop();
+    if (g_active_action.until != NAV_UNTIL_TIMEOUT)
+    {
+        goal_reached = IsActionGoalReached(snapshot);
+        if (goal_reached == 0U)
+        {
+            g_active_goal_armed = 1U;
+        }
+        else if ((g_active_goal_armed != 0U) && (elapsed >= g_active_action.min_ms))
+        {
+            ++g_nav_stats.early_exits;
+            TurnCalib_OnTurnComplete(snapshot, elapsed);
+            FinishActiveAction();
+            return;
+        }
+    }
+
+    if (elapsed < g_active_action.duration_ms)
+    {
+        return;
+    }
+
+    if (g_active_action.until != NAV_UNTIL_TIMEOUT)
+    {
+        ++g_nav_stats.timeouts;
+        TurnCalib_OnTurnRejected();
+    }
+    else
+    {
+        TurnCalib_OnTurnComplete(snapshot, elapsed);
+    }
+    FinishActiveAction();
 }
 
-static void PlanScene2(void)
+/*
+ * Safety guards are checked against every new snapshot while a planned action runs.
+ * Turn guards fire only on a side that was clear when the turn started, so a
+ * scene 3/4/5 turn next to a known wall is not cut short by that wall.
+ */
+static GuardVerdict EvaluateActionGuard(const SensorSnapshot *snapshot)
 {
-    ActionQueue_Clear();
-    g_scene5_countdown_mode = 0U;
+    switch (g_active_action.type)
+    {
+    case NAV_ACTION_PAUSE:
+        /* Obstacle moved away before the reverse started: plan is stale. */
+        return (snapshot->front_blocked == 0U) ? GUARD_ABORT : GUARD_CONTINUE;
+
+    case NAV_ACTION_TURN_LEFT_90:
+        if ((snapshot->left_blocked != 0U) && (g_active_start_left_blocked == 0U))
+        {
+            return GUARD_ABORT;
+        }
+        return GUARD_CONTINUE;
 
-    (void)ActionQueue_Push(ACTION_PAUSE, PAUSE_BEFORE_REVERSE_MS);
-    (void)ActionQueue_Push(ACTION_REVERSE, REVERSE_LONG_MS);
-    if (g_scene2_turn_toggle == 0U)
+    case NAV_ACTION_TURN_RIGHT_90:
+    case NAV_ACTION_U_TURN_180:
+        if ((snapshot->right_blocked != 0U) && (g_active_start_right_blocked == 0U))
+        {
+            return GUARD_ABORT;
+        }
+        return GUARD_CONTINUE;
+
+    default:
+        return GUARD_CONTINUE;
+    }
+}
+
+static void ApplyActionGuard(const SensorSnapshot *snapshot)
+{
+#if ENABLE_ACTION_GUARDS
+    GuardVerdict verdict;
+
+    if ((g_active_action_valid == 0U) || (g_active_action.priority != ACTION_PRIORITY_PLAN))
     {
-        (void)ActionQueue_Push(ACTION_TURN_LEFT_90, TURN_90_MS);
+        return;
     }
-    else
+
+    if ((HAL_GetTick() - g_active_action_start_ms) < ACTION_GUARD_SETTLE_MS)
+    {
+        return;
+    }
+
+    verdict = EvaluateActionGuard(snapshot);
+    if (verdict == GUARD_CONTINUE)
+    {
+        return;
+    }
+
+    /* The plan is stale: stop, then the scene logic replans once the stop ends. */
+    if (ActionQueue_Preempt(NAV_ACTION_PAUSE, ACTION_GUARD_STOP_MS, ACTION_PRIORITY_SAFETY, NAV_PLAN_DISCARD) != 0U)
+    {
+        ++g_nav_stats.guard_aborts;
+    }
+#else
+    (void)snapshot;
+#endif
+}
+
+static uint32_t ResolveStepDuration(NavActionType type, uint16_t duration_ms)
+{
+    if (duration_ms != NAV_STEP_DEFAULT_DURATION)
     {
-        (void)ActionQueue_Push(ACTION_TURN_RIGHT_90, TURN_90_MS);
+        return duration_ms;
     }
 
-    g_scene2_turn_toggle ^= 1U;
+    switch (type)
+    {
+    case NAV_ACTION_PAUSE:
+        return ParamStore_Get(PARAM_PAUSE_BEFORE_REVERSE_MS);
+    case NAV_ACTION_REVERSE:
+        return ParamStore_Get(PARAM_REVERSE_LONG_MS);
+    case NAV_ACTION_BACKOFF:
+        return ParamStore_Get(PARAM_BACKOFF_SHORT_MS);
+    case NAV_ACTION_TURN_LEFT_90:
+        return ParamStore_Get(PARAM_TURN_LEFT_90_MS);
+    case NAV_ACTION_TURN_RIGHT_90:
+        return ParamStore_Get(PARAM_TURN_RIGHT_90_MS);
+    case NAV_ACTION_U_TURN_180:
+        return ParamStore_Get(PARAM_TURN_180_MS);
+    case NAV_ACTION_SCAN:
+        return SCAN_TIMEOUT_MS;
+    default:
+        return 0U;
+    }
 }
 
-static void PlanScene3(void)
+/*
+ * Scene 2 turn side, in order of preference: away from a branch side that
+ * already led into a dead end, away from a side the map knows to be blocked,
+ * otherwise scan (or alternate without ENABLE_SCAN_TURNS). The choice is
+ * recorded as a branch point; a scan records it once it has picked a heading.
+ */
+static NavActionType ChooseTurnDirection(void)
 {
-    ActionQueue_Clear();
-    g_scene5_countdown_mode = 0U;
+    NavPose pose;
+    uint32_t now = HAL_GetTick();
+    RouteTurn turn;
+    uint8_t left_known_blocked;
+    uint8_t right_known_blocked;
 
-    (void)ActionQueue_Push(ACTION_BACKOFF, BACKOFF_SHORT_MS);
-    (void)ActionQueue_Push(ACTION_TURN_RIGHT_90, TURN_90_MS);
+    Pose_Get(&pose);
+    turn = RouteMemory_Recommend(g_counter, &pose, now);
+
+    if (turn == ROUTE_TURN_NONE)
+    {
+        left_known_blocked = OccGrid_IsHeadingBlocked(NAV_HALF_PI, OCC_QUERY_RANGE_CM);
+        right_known_blocked = OccGrid_IsHeadingBlocked(-NAV_HALF_PI, OCC_QUERY_RANGE_CM);
+
+        if ((left_known_blocked != 0U) && (right_known_blocked == 0U))
+        {
+            turn = ROUTE_TURN_RIGHT;
+        }
+        else if ((right_known_blocked != 0U) && (left_known_blocked == 0U))
+        {
+            turn = ROUTE_TURN_LEFT;
+        }
+        else
+        {
+#if ENABLE_SCAN_TURNS
+            return NAV_ACTION_SCAN;
+#else
+            g_scene2_turn_toggle ^= 1U;
+            turn = (g_scene2_turn_toggle != 0U) ? ROUTE_TURN_LEFT : ROUTE_TURN_RIGHT;
+#endif
+        }
+    }
+
+    RouteMemory_OnBranch(g_counter, &pose, now, turn);
+    return (turn == ROUTE_TURN_LEFT) ? NAV_ACTION_TURN_LEFT_90 : NAV_ACTION_TURN_RIGHT_90;
 }
 
-static void PlanScene4(void)
+static void QueuePlanStep(const NavPlanStep *step)
 {
+    TimedAction action;
+    NavActionType type = (NavActionType)step->action;
+
+    if (type == NAV_ACTION_TURN_ALTERNATE_90)
+    {
+        type = ChooseTurnDirection();
+    }
+
+    action.type = type;
+    action.priority = ACTION_PRIORITY_PLAN;
+    action.until = (type == NAV_ACTION_SCAN) ? NAV_UNTIL_TIMEOUT : (NavUntil)step->until;
+    action.until_cm = (step->until_cm != NAV_STEP_DEFAULT_CLEARANCE) ?
+                      step->until_cm : ParamStore_Get(PARAM_CLEAR_DISTANCE_CM);
+    action.duration_ms = ResolveStepDuration(type, step->duration_ms);
+    action.min_ms = 0U;
+
+    if ((action.until != NAV_UNTIL_TIMEOUT) && (IsTurnAction(type) != 0U))
+    {
+        action.min_ms = (action.duration_ms * ParamStore_Get(PARAM_TURN_MIN_PERCENT)) / 100U;
+    }
+
+    (void)ActionQueue_Push(&action);
+}
+
+static void PlanScene(NavSceneId scene)
+{
+    const NavPlanStep *steps;
+    uint8_t count = 0U;
+    uint8_t i;
+
     ActionQueue_Clear();
-    g_scene5_countdown_mode = 0U;
+    Steering_Reset();
+    if (scene == NAV_SCENE_5_FRONT_LEFT_RIGHT)
+    {
+        NavPose pose;
 
-    (void)ActionQueue_Push(ACTION_BACKOFF, BACKOFF_SHORT_MS);
-    (void)ActionQueue_Push(ACTION_TURN_LEFT_90, TURN_90_MS);
+        Pose_Get(&pose);
+        RouteMemory_OnDeadEnd(g_counter, &pose);
+        g_scene5_countdown_mode = 1U;
+        g_count_mode = COUNT_MODE_DOWN;
+    }
+    else
+    {
+        g_scene5_countdown_mode = 0U;
+    }
+
+    steps = ParamStore_GetScenePlan(scene, &count);
+    if (steps == NULL)
+    {
+        const ScenePlan *plan = &kScenePlans[ParamStore_Get(PARAM_PLAN_SET)][scene - NAV_SCENE_2_FRONT_ONLY];
+        steps = plan->steps;
+        count = plan->count;
+    }
+
+    for (i = 0U; i < count; ++i)
+    {
+        QueuePlanStep(&steps[i]);
+    }
+}
+
+static const ReplanRecord *ProgressMonitor_Entry(uint8_t age)
+{
+    /* age 0 = newest */
+    return &g_replan_history[(uint8_t)(g_replan_head + NAV_STALL_HISTORY - 1U - age) % NAV_STALL_HISTORY];
 }
 
-static void PlanScene5(void)
+static void ProgressMonitor_Reset(void)
 {
+    g_replan_head = 0U;
+    g_replan_count = 0U;
+}
+
+/* Largest distance between the newest replan and any of the given older ones. */
+static uint32_t ProgressMonitor_Spread(uint8_t entries)
+{
+    const ReplanRecord *newest = ProgressMonitor_Entry(0U);
+    uint32_t spread = 0U;
+    uint8_t age;
+
+    for (age = 1U; age < entries; ++age)
+    {
+        const ReplanRecord *old = ProgressMonitor_Entry(age);
+        int32_t dx = newest->x_mm - old->x_mm;
+        int32_t dy = newest->y_mm - old->y_mm;
+        uint32_t dist_sq = (uint32_t)((dx * dx) + (dy * dy));
+        if (dist_sq > spread)
+        {
+            spread = dist_sq;
+        }
+    }
+
+    return spread;
+}
+
+/* Replan sequence repeats with a period of 2..4 over two full periods (e.g. 2,3,2,4,2,3,2,4). */
+static uint8_t ProgressMonitor_IsPeriodic(uint8_t entries)
+{
+    uint8_t period;
+    uint8_t age;
+
+    for (period = 2U; period <= 4U; ++period)
+    {
+        uint8_t repeats = 1U;
+
+        if ((uint8_t)(period * 2U) > entries)
+        {
+            break;
+        }
+
+        for (age = 0U; age < period; ++age)
+        {
+            if (ProgressMonitor_Entry(age)->scene != ProgressMonitor_Entry((uint8_t)(age + period))->scene)
+            {
+                repeats = 0U;
+                break;
+            }
+        }
+
+        if (repeats != 0U)
+        {
+            return 1U;
+        }
+    }
+
+    return 0U;
+}
+
+/*
+ * Records a replan and checks the recent history for lack of progress:
+ * many replans inside NAV_STALL_WINDOW_MS without the pose moving more than
+ * NAV_STALL_MIN_PROGRESS_MM, or a repeating scene pattern that only creeps.
+ */
+static StallKind ProgressMonitor_RecordReplan(NavSceneId scene)
+{
+    ReplanRecord *slot = &g_replan_history[g_replan_head];
+    NavPose pose;
+    uint32_t now = HAL_GetTick();
+    uint8_t recent = 0U;
+    uint32_t spread_sq;
+
+    Pose_Get(&pose);
+    slot->at_ms = now;
+    slot->x_mm = pose.x_mm;
+    slot->y_mm = pose.y_mm;
+    slot->scene = (uint8_t)scene;
+    g_replan_head = (uint8_t)((g_replan_head + 1U) % NAV_STALL_HISTORY);
+    if (g_replan_count < NAV_STALL_HISTORY)
+    {
+        ++g_replan_count;
+    }
+
+    while ((recent < g_replan_count) && ((now - ProgressMonitor_Entry(recent)->at_ms) <= NAV_STALL_WINDOW_MS))
+    {
+        ++recent;
+    }
+
+    if (recent < NAV_STALL_MIN_REPLANS)
+    {
+        return STALL_NONE;
+    }
+
+    spread_sq = ProgressMonitor_Spread(recent);
+    if (spread_sq < ((uint32_t)NAV_STALL_MIN_PROGRESS_MM * NAV_STALL_MIN_PROGRESS_MM))
+    {
+        ++g_nav_stats.stalls_no_progress;
+        return STALL_NO_PROGRESS;
+    }
+
+    if ((ProgressMonitor_IsPeriodic(recent) != 0U) &&
+        (spread_sq < ((uint32_t)NAV_STALL_OSC_PROGRESS_MM * NAV_STALL_OSC_PROGRESS_MM)))
+    {
+        ++g_nav_stats.stalls_oscillation;
+        return STALL_OSCILLATION;
+    }
+
+    return STALL_NONE;
+}
+
+/* Escape: a longer reverse followed by a ~135 degree turn toward the more open side. */
+static void PlanEscape(const SensorSnapshot *snapshot)
+{
+    TimedAction action;
+
     ActionQueue_Clear();
-    g_scene5_countdown_mode = 1U;
-    g_count_mode = COUNT_MODE_DOWN;
+    Steering_Reset();
+    ProgressMonitor_Reset();
+
+    action.priority = ACTION_PRIORITY_PLAN;
+    action.until = NAV_UNTIL_TIMEOUT;
+    action.until_cm = 0U;
+    action.min_ms = 0U;
+
+    action.type = NAV_ACTION_REVERSE;
+    action.duration_ms = NAV_ESCAPE_REVERSE_MS;
+    (void)ActionQueue_Push(&action);
 
-    (void)ActionQueue_Push(ACTION_BACKOFF, BACKOFF_SHORT_MS);
-    (void)ActionQueue_Push(ACTION_U_TURN_180, TURN_180_MS);
+    action.type = (snapshot->left_cm > snapshot->right_cm) ? NAV_ACTION_TURN_LEFT_90 : NAV_ACTION_TURN_RIGHT_90;
+    action.duration_ms = (ResolveStepDuration(action.type, NAV_STEP_DEFAULT_DURATION) * NAV_ESCAPE_TURN_PERCENT) / 100U;
+    (void)ActionQueue_Push(&action);
 }
 
-void Navigation_Init(void)
+/* Run state only: the pose, maps and learned values carry over into the next run. */
+static void ResetRun(void)
 {
-    g_action_count = 0U;
+    ActionQueue_Clear();
     g_active_action_valid = 0U;
     g_counter = 0U;
     g_count_mode = COUNT_MODE_UP;
     g_scene = NAV_SCENE_1_CLEAR_FORWARD;
     g_motion = NAV_MOTION_STOP;
     g_halted = 0U;
+    g_host_stopped = 0U;
     g_scene5_countdown_mode = 0U;
     g_scene2_turn_toggle = 0U;
-    g_last_front_blocked = 0U;
-
+    g_mark_edge_pending = 0U;
+    ProgressMonitor_Reset();
+    Steering_Reset();
     SevenSeg_ShowNumber(0);
+}
+
+static void ApplyHostCommands(void)
+{
+    HostCmdOp op;
+
+    while (HostCmd_PopStaged(&op) != 0U)
+    {
+        switch (op.type)
+        {
+        case HOST_CMD_OP_SET_PARAM:
+            /* Takes effect with the next planned action; the active one keeps its resolved timing. */
+            (void)ParamStore_Set((ParamId)op.param, op.value);
+            break;
+
+        case HOST_CMD_OP_STOP:
+            if (g_halted == 0U)
+            {
+                /*
+                 * Keep the interrupted step and its plan for "start". Without the
+                 * preemption only the active step is lost; the queued plan stays.
+                 */
+                if (ActionQueue_Preempt(NAV_ACTION_PAUSE, 0U, ACTION_PRIORITY_CRITICAL, NAV_PLAN_RESUME) == 0U)
+                {
+                    g_active_action_valid = 0U;
+                }
+                g_halted = 1U;
+                g_host_stopped = 1U;
+                g_motion = NAV_MOTION_STOP;
+                Motor_Stop();
+                Buzzer_Stop();
+            }
+            break;
+
+        case HOST_CMD_OP_START:
+            ClearParamSaveFault();
+            if (g_host_stopped != 0U)
+            {
+                g_halted = 0U;
+                g_host_stopped = 0U;
+                ProgressMonitor_Reset();
+            }
+            else if (g_halted != 0U)
+            {
+                ResetRun();
+            }
+            break;
+
+        case HOST_CMD_OP_SET_PLAN:
+        {
+            NavPlanStep steps[NAV_PLAN_MAX_STEPS];
+            uint8_t count = (op.value != 0U) ? HostCmd_GetStagedPlan((NavSceneId)op.param, steps) : 0U;
+
+            /* Used from the next time the scene is planned. */
+            if (count != 0U)
+            {
+                (void)ParamStore_SetScenePlan((NavSceneId)op.param, steps, count);
+            }
+            else
+            {
+                ParamStore_ClearScenePlan((NavSceneId)op.param);
+            }
+            break;
+        }
+
+        case HOST_CMD_OP_SAVE:
+#if ENABLE_PARAM_FLASH
+            if (g_halted != 0U)
+            {
+                SaveDirtyParams();
+            }
+#endif
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+void Navigation_Init(void)
+{
+    NavEvents_Init();
+    ResetRun();
+    g_last_front_blocked = 0U;
+    g_last_blocked_mask = 0U;
+    g_nav_stats.guard_aborts = 0U;
+    g_nav_stats.early_exits = 0U;
+    g_nav_stats.timeouts = 0U;
+    g_nav_stats.stalls_no_progress = 0U;
+    g_nav_stats.stalls_oscillation = 0U;
+    g_nav_stats.scans = 0U;
+    g_nav_stats.scan_no_opening = 0U;
+    g_nav_stats.preempt_drops = 0U;
+    g_nav_stats.preempt_refused = 0U;
+
+    SpeedModel_Init();
+    Pose_Init();
+    OccGrid_Init();
+    RouteMemory_Init();
+    TurnCalib_Init();
     Motor_Stop();
 }
 
-void Navigation_Process(void)
+static uint8_t BlockedMask(const SensorSnapshot *snapshot)
+{
+    uint8_t mask = 0U;
+
+    if (snapshot->front_blocked != 0U)
+    {
+        mask |= NAV_EDGE_FRONT;
+    }
+    if (snapshot->left_blocked != 0U)
+    {
+        mask |= NAV_EDGE_LEFT;
+    }
+    if (snapshot->right_blocked != 0U)
+    {
+        mask |= NAV_EDGE_RIGHT;
+    }
+    return mask;
+}
+
+/*
+ * Fields the decision logic reads. With these unchanged a decision repeats
+ * itself, except for reactive steering: its smoothing filter still moves the
+ * wheel command toward the target, so it needs samples until it settles.
+ */
+static uint8_t IsSnapshotUnchanged(const SensorSnapshot *snapshot)
+{
+    if ((ParamStore_Get(PARAM_NAV_MODE) == (uint16_t)NAV_MODE_REACTIVE) && (Steering_IsSettled() == 0U))
+    {
+        return 0U;
+    }
+
+    return (uint8_t)((snapshot->front_cm == g_decided_snapshot.front_cm) &&
+                     (snapshot->left_cm == g_decided_snapshot.left_cm) &&
+                     (snapshot->right_cm == g_decided_snapshot.right_cm) &&
+                     (snapshot->front_closing_cm_s == g_decided_snapshot.front_closing_cm_s) &&
+                     (snapshot->front_blocked == g_decided_snapshot.front_blocked) &&
+                     (snapshot->left_blocked == g_decided_snapshot.left_blocked) &&
+                     (snapshot->right_blocked == g_decided_snapshot.right_blocked));
+}
+
+/*
+ * Sample event: read the sensors, integrate the motion of the last period and
+ * post the edges found in the new snapshot. Returns 1 when a decision is
+ * still needed for this sample itself (nothing was posted that will run one).
+ */
+static uint8_t SampleSensors(uint32_t stamp_cycles)
 {
     const SensorSnapshot *snapshot;
     uint8_t any_obstacle;
+    uint8_t blocked_mask;
+    uint8_t posted = 0U;
 
+#if !ENABLE_RTOS
+    /* The RTOS build acquires in the sensor thread. */
     Sensors_Update();
+#endif
+    Sensors_Latch();
     snapshot = Sensors_GetSnapshot();
 
+    /* Integrate the motion commanded during the last cycle before changing it. */
+    SpeedModel_Update();
+    Pose_Update(HAL_GetTick());
+    Pose_OnWallObservation(snapshot);
+    OccGrid_Update(snapshot);
+
     any_obstacle = (uint8_t)((snapshot->front_blocked != 0U) ||
                              (snapshot->left_blocked != 0U) ||
                              (snapshot->right_blocked != 0U));
     Indicators_SetObstacleLed(any_obstacle);
     Indicators_SetMarkLed(snapshot->mark_detected);
 
+    if (Sensors_ConsumeMarkEdge() != 0U)
+    {
+        g_mark_edge_pending = 1U;
+        posted |= NavEvents_Post(NAV_EVENT_MARK, 0U, stamp_cycles);
+    }
+
+    blocked_mask = BlockedMask(snapshot);
+    if (blocked_mask != g_last_blocked_mask)
+    {
+        posted |= NavEvents_Post(NAV_EVENT_OBSTACLE_EDGE, (uint8_t)(blocked_mask ^ g_last_blocked_mask), stamp_cycles);
+        g_last_blocked_mask = blocked_mask;
+    }
+
+    if (posted != 0U)
+    {
+        return 0U;
+    }
+
+    /* Running actions have time-based conditions (min_ms), so they always re-evaluate. */
+    if ((g_active_action_valid == 0U) && (g_action_count == 0U) && (IsSnapshotUnchanged(snapshot) != 0U))
+    {
+        NavEvents_CountSkippedSample();
+        return 0U;
+    }
+
+    return 1U;
+}
+
+static void Decide(void)
+{
+    const SensorSnapshot *snapshot = Sensors_GetSnapshot();
+    uint8_t forward_percent;
+
+    g_decided_snapshot = *snapshot;
+
     HandleMarkEvent();
     HandleFrontObstacleEdge(snapshot);
 
@@ -318,7 +1284,8 @@ void Navigation_Process(void)
         return;
     }
 
-    ProcessActiveAction();
+    ApplyActionGuard(snapshot);
+    ProcessActiveAction(snapshot);
     StartNextActionIfIdle();
 
     if ((g_active_action_valid != 0U) || (g_action_count != 0U))
@@ -348,7 +1315,18 @@ void Navigation_Process(void)
         }
 
         g_motion = NAV_MOTION_FORWARD;
-        Motor_SetSpeed(MOTOR_SPEED_FORWARD_PERCENT, MOTOR_SPEED_FORWARD_PERCENT);
+        forward_percent = Steering_ScheduleSpeed(snapshot);
+        if (ParamStore_Get(PARAM_NAV_MODE) == (uint16_t)NAV_MODE_REACTIVE)
+        {
+            SteeringCommand steer;
+
+            Steering_Compute(snapshot, forward_percent, &steer);
+            Motor_SetSpeed(steer.left_percent, steer.right_percent);
+        }
+        else
+        {
+            Motor_SetSpeed(forward_percent, forward_percent);
+        }
         Motor_Forward();
         return;
     }
@@ -356,27 +1334,56 @@ void Navigation_Process(void)
     if ((snapshot->left_blocked == 0U) && (snapshot->right_blocked == 0U))
     {
         g_scene = NAV_SCENE_2_FRONT_ONLY;
-        PlanScene2();
     }
     else if ((snapshot->left_blocked != 0U) && (snapshot->right_blocked == 0U))
     {
         g_scene = NAV_SCENE_3_FRONT_LEFT;
-        PlanScene3();
     }
     else if ((snapshot->left_blocked == 0U) && (snapshot->right_blocked != 0U))
     {
         g_scene = NAV_SCENE_4_FRONT_RIGHT;
-        PlanScene4();
     }
     else
     {
         g_scene = NAV_SCENE_5_FRONT_LEFT_RIGHT;
-        PlanScene5();
+    }
+
+    if (ProgressMonitor_RecordReplan(g_scene) != STALL_NONE)
+    {
+        PlanEscape(snapshot);
+    }
+    else
+    {
+        PlanScene(g_scene);
     }
 
     StartNextActionIfIdle();
 }
 
+void Navigation_HandleEvent(const NavEvent *event)
+{
+    if (event == NULL)
+    {
+        return;
+    }
+
+    if ((event->type == (uint8_t)NAV_EVENT_SAMPLE) && (SampleSensors(event->stamp_cycles) == 0U))
+    {
+        return;
+    }
+
+    /* Host changes land here, between two decisions, never inside one. */
+    if (event->type == (uint8_t)NAV_EVENT_COMMAND)
+    {
+        ApplyHostCommands();
+    }
+
+    Decide();
+    /* Bridge and display changes of this decision leave in one BSRR write per port. */
+    GpioOut_Flush();
+    NavEvents_RecordLatency(event, CycleCounter_Now());
+}
+
 uint8_t Navigation_GetCounter(void)
 {
     return g_counter;
@@ -391,3 +1398,18 @@ NavMotion Navigation_GetMotion(void)
 {
     return g_motion;
 }
+
+uint8_t Navigation_IsHalted(void)
+{
+    return g_halted;
+}
+
+const NavStats *Navigation_GetStats(void)
+{
+    return &g_nav_stats;
+}
+
+void Navigation_GetPose(NavPose *pose)
+{
+    Pose_Get(pose);
+}
@@ -0,0 +1,193 @@
+#include "occupancy_grid.h"
+
+#include <math.h>
+
+#include "app_config.h"
+#include "pose.h"
+
+/*
+ * Fixed-size occupancy grid centered on the start pose, 2 bits per cell
+ * (four cells per byte). Cells act as saturating counters:
+ * a range hit moves a cell toward OCCUPIED, a ray passing through moves it
+ * toward FREE, so single noisy readings never flip a cell outright.
+ */
+
+#define OCC_GRID_BYTES      ((OCC_GRID_SIZE * OCC_GRID_SIZE) / 4U)
+#define OCC_GRID_HALF_MM    ((int32_t)(OCC_GRID_SIZE / 2U) * (int32_t)OCC_GRID_CELL_MM)
+#define OCC_HALF_PI         1.57079633f
+
+#if ((OCC_GRID_SIZE % 4U) != 0U) || (OCC_GRID_BYTES > 4096U)
+#error "OCC_GRID_SIZE must be a multiple of 4 and fit the 4 KB grid budget"
+#endif
+
+static uint8_t g_occ_cells[OCC_GRID_BYTES];
+
+static uint8_t OccGrid_CellIndex(int32_t x_mm, int32_t y_mm, uint16_t *index)
+{
+    int32_t col = (x_mm + OCC_GRID_HALF_MM) / (int32_t)OCC_GRID_CELL_MM;
+    int32_t row = (y_mm + OCC_GRID_HALF_MM) / (int32_t)OCC_GRID_CELL_MM;
+
+    if ((x_mm + OCC_GRID_HALF_MM < 0) || (y_mm + OCC_GRID_HALF_MM < 0) ||
+        (col >= (int32_t)OCC_GRID_SIZE) || (row >= (int32_t)OCC_GRID_SIZE))
+    {
+        return 0U;
+    }
+
+    *index = (uint16_t)((uint32_t)row * OCC_GRID_SIZE + (uint32_t)col);
+    return 1U;
+}
+
+static OccCell OccGrid_Read(uint16_t index)
+{
+    return (OccCell)((g_occ_cells[index >> 2U] >> ((index & 3U) * 2U)) & 0x03U);
+}
+
+static void OccGrid_Write(uint16_t index, OccCell cell)
+{
+    uint8_t shift = (uint8_t)((index & 3U) * 2U);
+    uint8_t *byte = &g_occ_cells[index >> 2U];
+
+    *byte = (uint8_t)((*byte & (uint8_t)~(0x03U << shift)) | ((uint8_t)cell << shift));
+}
+
+static void OccGrid_MarkHit(uint16_t index)
+{
+    switch (OccGrid_Read(index))
+    {
+    case OCC_CELL_MAYBE_OCCUPIED:
+    case OCC_CELL_OCCUPIED:
+        OccGrid_Write(index, OCC_CELL_OCCUPIED);
+        break;
+    default:
+        OccGrid_Write(index, OCC_CELL_MAYBE_OCCUPIED);
+        break;
+    }
+}
+
+static void OccGrid_MarkMiss(uint16_t index)
+{
+    if (OccGrid_Read(index) == OCC_CELL_OCCUPIED)
+    {
+        OccGrid_Write(index, OCC_CELL_MAYBE_OCCUPIED);
+    }
+    else
+    {
+        OccGrid_Write(index, OCC_CELL_FREE);
+    }
+}
+
+/*
+ * Half-cell steps along the beam: free up to the return, occupied at it.
+ * Each cell is updated at most once per beam, and the cell of the return
+ * never takes a miss from its own beam.
+ */
+static void OccGrid_TraceBeam(const NavPose *pose, float heading, uint16_t distance_cm)
+{
+    float cos_h = cosf(heading);
+    float sin_h = sinf(heading);
+    float dx = cos_h * ((float)OCC_GRID_CELL_MM * 0.5f);
+    float dy = sin_h * ((float)OCC_GRID_CELL_MM * 0.5f);
+    uint16_t limit_cm = (distance_cm < OCC_MAX_RANGE_CM) ? distance_cm : OCC_MAX_RANGE_CM;
+    uint16_t steps = (uint16_t)(((uint32_t)limit_cm * 20U) / OCC_GRID_CELL_MM);
+    uint16_t i;
+    uint16_t index;
+    uint16_t hit_index = 0U;
+    uint16_t last_index = 0U;
+    uint8_t has_hit = 0U;
+    uint8_t has_last = 0U;
+    float x = (float)pose->x_mm;
+    float y = (float)pose->y_mm;
+
+    if (distance_cm < OCC_MAX_RANGE_CM)
+    {
+        float range_mm = (float)distance_cm * 10.0f;
+        has_hit = OccGrid_CellIndex(pose->x_mm + (int32_t)(cos_h * range_mm),
+                                    pose->y_mm + (int32_t)(sin_h * range_mm),
+                                    &hit_index);
+    }
+
+    for (i = 0U; i < steps; ++i)
+    {
+        if ((OccGrid_CellIndex((int32_t)x, (int32_t)y, &index) != 0U) &&
+            ((has_last == 0U) || (index != last_index)))
+        {
+            if ((has_hit == 0U) || (index != hit_index))
+            {
+                OccGrid_MarkMiss(index);
+            }
+            last_index = index;
+            has_last = 1U;
+        }
+        x += dx;
+        y += dy;
+    }
+
+    if (has_hit != 0U)
+    {
+        OccGrid_MarkHit(hit_index);
+    }
+}
+
+void OccGrid_Init(void)
+{
+    uint16_t i;
+
+    for (i = 0U; i < OCC_GRID_BYTES; ++i)
+    {
+        g_occ_cells[i] = 0U;
+    }
+}
+
+void OccGrid_Update(const SensorSnapshot *snapshot)
+{
+    NavPose pose;
+    float heading;
+
+    if (snapshot == NULL)
+    {
+        return;
+    }
+
+    Pose_Get(&pose);
+    heading = Pose_GetHeadingRad();
+
+    OccGrid_TraceBeam(&pose, heading, snapshot->front_cm);
+    OccGrid_TraceBeam(&pose, heading + OCC_HALF_PI, snapshot->left_cm);
+    OccGrid_TraceBeam(&pose, heading - OCC_HALF_PI, snapshot->right_cm);
+}
+
+OccCell OccGrid_GetCellAt(int32_t x_mm, int32_t y_mm)
+{
+    uint16_t index;
+
+    if (OccGrid_CellIndex(x_mm, y_mm, &index) == 0U)
+    {
+        return OCC_CELL_UNKNOWN;
+    }
+    return OccGrid_Read(index);
+}
+
+uint8_t OccGrid_IsHeadingBlocked(float relative_rad, uint16_t range_cm)
+{
+    NavPose pose;
+    float heading;
+    float step_mm = (float)OCC_GRID_CELL_MM * 0.5f;
+    float distance_mm = step_mm;
+
+    Pose_Get(&pose);
+    heading = Pose_GetHeadingRad() + relative_rad;
+
+    while (distance_mm <= (float)range_cm * 10.0f)
+    {
+        int32_t x = pose.x_mm + (int32_t)(cosf(heading) * distance_mm);
+        int32_t y = pose.y_mm + (int32_t)(sinf(heading) * distance_mm);
+
+        if (OccGrid_GetCellAt(x, y) == OCC_CELL_OCCUPIED)
+        {
+            return 1U;
+        }
+        distance_mm += step_mm;
+    }
+
+    return 0U;
+}
@@ -0,0 +1,434 @@
+#include "param_store.h"
+
+#include <stddef.h>
+
+#include "app_config.h"
+#include "stm32f4xx_hal.h"
+
+typedef struct
+{
+    const char *name;
+    uint16_t default_value;
+    uint16_t min_value;
+    uint16_t max_value;
+} ParamInfo;
+
+typedef struct
+{
+    NavPlanStep steps[NAV_PLAN_MAX_STEPS];
+    uint8_t count;
+    uint8_t valid;
+} ScenePlanOverride;
+
+#define PARAM_SCENE_PLAN_SLOTS 4U
+#define PARAM_PLAN_STEP_MAX_MS 10000U
+
+/*
+ * Flash record: header word (magic | count), the values packed two per word,
+ * the scene plan overrides and a checksum word. Plans are one word with the
+ * step count of each slot (0 = none), then NAV_PLAN_MAX_STEPS step words per
+ * slot: action | until << 4 | until_cm << 8 | duration_ms << 16.
+ * Records are appended; the last intact one wins.
+ */
+#define PARAM_FLASH_MAGIC       0xC0DFU /* 0xC0DE records had no plan words */
+#define PARAM_FLASH_VALUE_WORDS ((PARAM_COUNT + 1U) / 2U)
+#define PARAM_FLASH_PLAN_WORDS  (1U + (PARAM_SCENE_PLAN_SLOTS * NAV_PLAN_MAX_STEPS))
+#define PARAM_FLASH_RECORD_WORDS (PARAM_FLASH_VALUE_WORDS + PARAM_FLASH_PLAN_WORDS + 2U)
+#define PARAM_FLASH_RECORD_BYTES (PARAM_FLASH_RECORD_WORDS * 4U)
+#define PARAM_FLASH_ERASED      0xFFFFFFFFUL
+
+static const ParamInfo kParamInfo[PARAM_COUNT] =
+{
+    {"plan_set", 0U, 0U, NAV_PLAN_SET_COUNT - 1U},
+    {"nav_mode", NAV_DEFAULT_MODE, NAV_MODE_SCENES, NAV_MODE_REACTIVE},
+    {"pause_ms", PAUSE_BEFORE_REVERSE_MS, 0U, 2000U},
+    {"reverse_ms", REVERSE_LONG_MS, 50U, 4000U},
+    {"backoff_ms", BACKOFF_SHORT_MS, 50U, 2000U},
+    {"turn_left_ms", TURN_90_MS, 100U, 2000U},
+    {"turn_right_ms", TURN_90_MS, 100U, 2000U},
+    {"turn180_ms", TURN_180_MS, 200U, 4000U},
+    {"clear_cm", NAV_CLEAR_DISTANCE_CM, IR_RANGE_MIN_CM, IR_RANGE_MAX_CM - 1U},
+    {"turn_min_pct", NAV_TURN_MIN_PERCENT, 0U, 100U},
+    {"bt_baud_x100", BLUETOOTH_BAUD_DEFAULT / 100U, 96U, 4608U}
+};
+
+static uint16_t g_param_values[PARAM_COUNT];
+static ScenePlanOverride g_param_scene_plans[PARAM_SCENE_PLAN_SLOTS];
+static uint8_t g_param_dirty = 0U;
+
+static uint8_t ParamStore_SceneSlot(NavSceneId scene, uint8_t *slot)
+{
+    if ((scene < NAV_SCENE_2_FRONT_ONLY) || (scene > NAV_SCENE_5_FRONT_LEFT_RIGHT))
+    {
+        return 0U;
+    }
+
+    *slot = (uint8_t)(scene - NAV_SCENE_2_FRONT_ONLY);
+    return 1U;
+}
+
+#if PARAM_SCENE_PLAN_SLOTS > 4U
+#error "the plan count word holds at most four slots"
+#endif
+
+#if ENABLE_PARAM_FLASH
+static uint32_t ParamStore_Checksum(const uint32_t *words, uint32_t count)
+{
+    uint32_t sum = 0x5A5A5A5AUL;
+    uint32_t i;
+
+    for (i = 0U; i < count; ++i)
+    {
+        sum = ((sum << 5) | (sum >> 27)) ^ words[i];
+    }
+    return sum;
+}
+
+static void ParamStore_PackPlans(uint32_t *words)
+{
+    uint32_t slot;
+    uint32_t i;
+
+    words[0] = 0U;
+    for (slot = 0U; slot < PARAM_SCENE_PLAN_SLOTS; ++slot)
+    {
+        const ScenePlanOverride *plan = &g_param_scene_plans[slot];
+        uint32_t *step_words = &words[1U + (slot * NAV_PLAN_MAX_STEPS)];
+
+        if (plan->valid != 0U)
+        {
+            words[0] |= (uint32_t)plan->count << (slot * 8U);
+        }
+        for (i = 0U; i < NAV_PLAN_MAX_STEPS; ++i)
+        {
+            const NavPlanStep *step = &plan->steps[i];
+
+            step_words[i] = ((plan->valid != 0U) && (i < plan->count))
+                                ? ((uint32_t)step->action | ((uint32_t)step->until << 4) |
+                                   ((uint32_t)step->until_cm << 8) | ((uint32_t)step->duration_ms << 16))
+                                : 0U;
+        }
+    }
+}
+
+/* Overrides that no longer pass validation are dropped. */
+static void ParamStore_LoadPlans(const uint32_t *words)
+{
+    NavPlanStep steps[NAV_PLAN_MAX_STEPS];
+    uint32_t slot;
+    uint32_t i;
+
+    for (slot = 0U; slot < PARAM_SCENE_PLAN_SLOTS; ++slot)
+    {
+        uint8_t count = (uint8_t)((words[0] >> (slot * 8U)) & 0xFFU);
+        const uint32_t *step_words = &words[1U + (slot * NAV_PLAN_MAX_STEPS)];
+
+        if ((count == 0U) || (count > NAV_PLAN_MAX_STEPS))
+        {
+            continue;
+        }
+        for (i = 0U; i < count; ++i)
+        {
+            steps[i].action = (uint8_t)(step_words[i] & 0x0FU);
+            steps[i].until = (uint8_t)((step_words[i] >> 4) & 0x0FU);
+            steps[i].until_cm = (uint8_t)((step_words[i] >> 8) & 0xFFU);
+            steps[i].duration_ms = (uint16_t)(step_words[i] >> 16);
+        }
+        (void)ParamStore_SetScenePlan((NavSceneId)(NAV_SCENE_2_FRONT_ONLY + slot), steps, count);
+    }
+}
+
+static void ParamStore_Pack(uint32_t *record)
+{
+    uint32_t i;
+
+    record[0] = ((uint32_t)PARAM_FLASH_MAGIC << 16) | (uint32_t)PARAM_COUNT;
+    for (i = 0U; i < PARAM_FLASH_VALUE_WORDS; ++i)
+    {
+        uint32_t lo = g_param_values[2U * i];
+        uint32_t hi = ((2U * i + 1U) < PARAM_COUNT) ? g_param_values[2U * i + 1U] : 0xFFFFU;
+        record[1U + i] = (hi << 16) | lo;
+    }
+    ParamStore_PackPlans(&record[1U + PARAM_FLASH_VALUE_WORDS]);
+    record[PARAM_FLASH_RECORD_WORDS - 1U] = ParamStore_Checksum(record, PARAM_FLASH_RECORD_WORDS - 1U);
+}
+
+static uint8_t ParamStore_IsRecordValid(const uint32_t *record)
+{
+    if (record[0] != (((uint32_t)PARAM_FLASH_MAGIC << 16) | (uint32_t)PARAM_COUNT))
+    {
+        return 0U;
+    }
+    return (uint8_t)(record[PARAM_FLASH_RECORD_WORDS - 1U] ==
+                     ParamStore_Checksum(record, PARAM_FLASH_RECORD_WORDS - 1U));
+}
+
+/* First free slot in the sector, or PARAM_FLASH_SIZE when the sector is full. */
+static uint32_t ParamStore_FindFreeOffset(const uint32_t **last_valid)
+{
+    uint32_t offset;
+
+    *last_valid = NULL;
+    for (offset = 0U; (offset + PARAM_FLASH_RECORD_BYTES) <= PARAM_FLASH_SIZE; offset += PARAM_FLASH_RECORD_BYTES)
+    {
+        const uint32_t *record = (const uint32_t *)(PARAM_FLASH_ADDR + offset);
+        if (record[0] == PARAM_FLASH_ERASED)
+        {
+            return offset;
+        }
+        if (ParamStore_IsRecordValid(record) != 0U)
+        {
+            *last_valid = record;
+        }
+    }
+    return PARAM_FLASH_SIZE;
+}
+
+static void ParamStore_Load(void)
+{
+    const uint32_t *record;
+    uint32_t i;
+
+    (void)ParamStore_FindFreeOffset(&record);
+    if (record == NULL)
+    {
+        return;
+    }
+
+    /* Values that no longer fit their range keep the default. */
+    for (i = 0U; i < PARAM_COUNT; ++i)
+    {
+        uint32_t word = record[1U + (i / 2U)];
+        uint16_t value = (uint16_t)(((i & 1U) != 0U) ? (word >> 16) : (word & 0xFFFFU));
+        (void)ParamStore_Set((ParamId)i, value);
+    }
+    ParamStore_LoadPlans(&record[1U + PARAM_FLASH_VALUE_WORDS]);
+}
+#endif
+
+void ParamStore_Init(void)
+{
+    ParamStore_RestoreDefaults();
+#if ENABLE_PARAM_FLASH
+    ParamStore_Load();
+#endif
+    g_param_dirty = 0U;
+}
+
+uint8_t ParamStore_IsDirty(void)
+{
+    return g_param_dirty;
+}
+
+uint8_t ParamStore_Save(void)
+{
+#if ENABLE_PARAM_FLASH
+    uint32_t record[PARAM_FLASH_RECORD_WORDS];
+    const uint32_t *last_valid;
+    uint32_t offset;
+    uint32_t i;
+    uint8_t ok = 1U;
+
+    ParamStore_Pack(record);
+    offset = ParamStore_FindFreeOffset(&last_valid);
+
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR |
+                           FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+
+    if (offset >= PARAM_FLASH_SIZE)
+    {
+        FLASH_EraseInitTypeDef erase;
+        uint32_t sector_error = 0U;
+
+        erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+        erase.Banks = FLASH_BANK_1;
+        erase.Sector = PARAM_FLASH_SECTOR;
+        erase.NbSectors = 1U;
+        erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+        if (HAL_FLASHEx_Erase(&erase, &sector_error) != HAL_OK)
+        {
+            ok = 0U;
+        }
+        offset = 0U;
+    }
+
+    for (i = 0U; (ok != 0U) && (i < PARAM_FLASH_RECORD_WORDS); ++i)
+    {
+        if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, PARAM_FLASH_ADDR + offset + (i * 4U), record[i]) != HAL_OK)
+        {
+            ok = 0U;
+        }
+    }
+
+    HAL_FLASH_Lock();
+
+    if (ok != 0U)
+    {
+        g_param_dirty = 0U;
+    }
+    return ok;
+#else
+    return 0U;
+#endif
+}
+
+void ParamStore_RestoreDefaults(void)
+{
+    uint8_t i;
+
+    for (i = 0U; i < (uint8_t)PARAM_COUNT; ++i)
+    {
+        g_param_values[i] = kParamInfo[i].default_value;
+    }
+
+    for (i = 0U; i < PARAM_SCENE_PLAN_SLOTS; ++i)
+    {
+        g_param_scene_plans[i].count = 0U;
+        g_param_scene_plans[i].valid = 0U;
+    }
+}
+
+uint16_t ParamStore_Get(ParamId id)
+{
+    if (id >= PARAM_COUNT)
+    {
+        return 0U;
+    }
+    return g_param_values[id];
+}
+
+uint8_t ParamStore_IsValid(ParamId id, uint16_t value)
+{
+    if (id >= PARAM_COUNT)
+    {
+        return 0U;
+    }
+    return (uint8_t)((value >= kParamInfo[id].min_value) && (value <= kParamInfo[id].max_value));
+}
+
+uint8_t ParamStore_Set(ParamId id, uint16_t value)
+{
+    if (ParamStore_IsValid(id, value) == 0U)
+    {
+        return 0U;
+    }
+
+    if (g_param_values[id] != value)
+    {
+        g_param_values[id] = value;
+        g_param_dirty = 1U;
+    }
+    return 1U;
+}
+
+const char *ParamStore_GetName(ParamId id)
+{
+    if (id >= PARAM_COUNT)
+    {
+        return NULL;
+    }
+    return kParamInfo[id].name;
+}
+
+uint8_t ParamStore_IsScenePlanValid(NavSceneId scene, const NavPlanStep *steps, uint8_t count)
+{
+    uint8_t slot;
+    uint8_t i;
+
+    if ((steps == NULL) || (count == 0U) || (count > NAV_PLAN_MAX_STEPS))
+    {
+        return 0U;
+    }
+
+    if (ParamStore_SceneSlot(scene, &slot) == 0U)
+    {
+        return 0U;
+    }
+
+    for (i = 0U; i < count; ++i)
+    {
+        if ((steps[i].action == NAV_ACTION_NONE) || (steps[i].action > NAV_ACTION_SCAN))
+        {
+            return 0U;
+        }
+        if (steps[i].until > NAV_UNTIL_RIGHT_CLEAR)
+        {
+            return 0U;
+        }
+        if ((steps[i].until_cm != NAV_STEP_DEFAULT_CLEARANCE) &&
+            ((steps[i].until_cm < IR_RANGE_MIN_CM) || (steps[i].until_cm >= IR_RANGE_MAX_CM)))
+        {
+            return 0U;
+        }
+        if (steps[i].duration_ms > PARAM_PLAN_STEP_MAX_MS)
+        {
+            return 0U;
+        }
+    }
+    return 1U;
+}
+
+uint8_t ParamStore_SetScenePlan(NavSceneId scene, const NavPlanStep *steps, uint8_t count)
+{
+    ScenePlanOverride *plan;
+    uint8_t slot;
+    uint8_t changed;
+    uint8_t i;
+
+    if (ParamStore_IsScenePlanValid(scene, steps, count) == 0U)
+    {
+        return 0U;
+    }
+
+    (void)ParamStore_SceneSlot(scene, &slot);
+    plan = &g_param_scene_plans[slot];
+    changed = (uint8_t)((plan->valid == 0U) || (plan->count != count));
+    for (i = 0U; i < count; ++i)
+    {
+        const NavPlanStep *old_step = &plan->steps[i];
+
+        if ((old_step->action != steps[i].action) || (old_step->until != steps[i].until) ||
+            (old_step->until_cm != steps[i].until_cm) || (old_step->duration_ms != steps[i].duration_ms))
+        {
+            changed = 1U;
+        }
+        plan->steps[i] = steps[i];
+    }
+    plan->count = count;
+    plan->valid = 1U;
+    if (changed != 0U)
+    {
+        g_param_dirty = 1U;
+    }
+    return 1U;
+}
+
+void ParamStore_ClearScenePlan(NavSceneId scene)
+{
+    uint8_t slot;
+
+    if ((ParamStore_SceneSlot(scene, &slot) != 0U) && (g_param_scene_plans[slot].valid != 0U))
+    {
+        g_param_scene_plans[slot].valid = 0U;
+        g_param_dirty = 1U;
+    }
+}
+
+const NavPlanStep *ParamStore_GetScenePlan(NavSceneId scene, uint8_t *count)
+{
+    uint8_t slot;
+
+    if ((count == NULL) || (ParamStore_SceneSlot(scene, &slot) == 0U))
+    {
+        return NULL;
+    }
+
+    if (g_param_scene_plans[slot].valid == 0U)
+    {
+        return NULL;
+    }
+
+    *count = g_param_scene_plans[slot].count;
+    return g_param_scene_plans[slot].steps;
+}
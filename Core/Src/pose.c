@@ -0,0 +1,235 @@
+#include "pose.h"
+
+#include <math.h>
+
+#include "app_config.h"
+#include "motor.h"
+#include "speed_model.h"
+
+/*
+ * Dead reckoning from commanded motion. Wheel speeds come from the commanded
+ * duty through a linear duty->speed model, integrated as a differential drive.
+ * Two corrections keep the drift bounded:
+ * - mark crossings: with ENABLE_MARK_SPEED_MODEL the duty->speed line is fitted
+ *   from mark timing (speed_model.c); otherwise the path length between marks
+ *   is compared with MARK_SPACING_MM and scales the fixed model;
+ * - wall observations: driving straight along a side wall gives the angle to
+ *   the wall; walls are assumed axis-aligned (maze), so heading is pulled
+ *   toward the nearest multiple of 90 degrees plus that angle.
+ */
+
+#define POSE_PI         3.14159265f
+#define POSE_HALF_PI    1.57079633f
+#define POSE_TWO_PI     6.28318531f
+
+static float g_pose_x_mm = 0.0f;
+static float g_pose_y_mm = 0.0f;
+static float g_pose_heading_rad = 0.0f;
+static float g_pose_speed_scale = 1.0f;
+static uint32_t g_pose_last_ms = 0U;
+
+static float g_pose_path_since_mark_mm = 0.0f;
+static uint8_t g_pose_mark_seen = 0U;
+
+static uint8_t g_pose_straight = 0U;
+static float g_pose_segment_mm = 0.0f;
+static uint16_t g_pose_segment_left_cm = 0U;
+static uint16_t g_pose_segment_right_cm = 0U;
+
+static float Pose_WrapAngle(float angle)
+{
+    while (angle >= POSE_PI)
+    {
+        angle -= POSE_TWO_PI;
+    }
+    while (angle < -POSE_PI)
+    {
+        angle += POSE_TWO_PI;
+    }
+    return angle;
+}
+
+static float Pose_WheelSpeedMmS(int8_t duty_percent)
+{
+    int16_t duty = duty_percent;
+    int16_t magnitude = (duty < 0) ? (int16_t)-duty : duty;
+    float speed;
+
+    if (magnitude <= (int16_t)POSE_DUTY_DEADBAND_PERCENT)
+    {
+        return 0.0f;
+    }
+
+#if ENABLE_MARK_SPEED_MODEL
+    speed = SpeedModel_WheelSpeedMmS((uint8_t)magnitude);
+#else
+    speed = ((float)(magnitude - (int16_t)POSE_DUTY_DEADBAND_PERCENT) * (float)POSE_WHEEL_SPEED_MM_S_AT_100) /
+            (float)(100 - (int16_t)POSE_DUTY_DEADBAND_PERCENT);
+    speed *= g_pose_speed_scale;
+#endif
+    return (duty < 0) ? -speed : speed;
+}
+
+static void Pose_StartWallSegment(const SensorSnapshot *snapshot)
+{
+    g_pose_segment_mm = 0.0f;
+    g_pose_segment_left_cm = snapshot->left_cm;
+    g_pose_segment_right_cm = snapshot->right_cm;
+}
+
+void Pose_Init(void)
+{
+    g_pose_x_mm = 0.0f;
+    g_pose_y_mm = 0.0f;
+    g_pose_heading_rad = 0.0f;
+    g_pose_speed_scale = 1.0f;
+    g_pose_last_ms = 0U;
+    g_pose_path_since_mark_mm = 0.0f;
+    g_pose_mark_seen = 0U;
+    g_pose_straight = 0U;
+    g_pose_segment_mm = 0.0f;
+}
+
+void Pose_Update(uint32_t now_ms)
+{
+    int8_t left_duty;
+    int8_t right_duty;
+    float v_left;
+    float v_right;
+    float v;
+    float omega;
+    float dt;
+    float mid_heading;
+
+    if (g_pose_last_ms == 0U)
+    {
+        g_pose_last_ms = now_ms;
+        return;
+    }
+
+    dt = (float)(now_ms - g_pose_last_ms) * 0.001f;
+    g_pose_last_ms = now_ms;
+
+    Motor_GetCommand(&left_duty, &right_duty);
+    v_left = Pose_WheelSpeedMmS(left_duty);
+    v_right = Pose_WheelSpeedMmS(right_duty);
+
+    v = 0.5f * (v_left + v_right);
+    omega = (v_right - v_left) / (float)POSE_TRACK_WIDTH_MM;
+
+    /* Midpoint integration: translate along the average heading of the step. */
+    mid_heading = g_pose_heading_rad + 0.5f * omega * dt;
+    g_pose_x_mm += v * dt * cosf(mid_heading);
+    g_pose_y_mm += v * dt * sinf(mid_heading);
+    g_pose_heading_rad = Pose_WrapAngle(g_pose_heading_rad + omega * dt);
+
+    g_pose_path_since_mark_mm += fabsf(v * dt);
+
+    /* Wall segments only make sense while driving straight ahead. */
+    g_pose_straight = (uint8_t)((left_duty > 0) && (left_duty == right_duty));
+    if (g_pose_straight != 0U)
+    {
+        g_pose_segment_mm += v * dt;
+    }
+}
+
+void Pose_OnMark(void)
+{
+#if !ENABLE_MARK_SPEED_MODEL
+    float ratio;
+
+    if ((g_pose_mark_seen != 0U) && (g_pose_path_since_mark_mm > 0.0f))
+    {
+        ratio = (float)MARK_SPACING_MM / g_pose_path_since_mark_mm;
+
+        /* Ignore intervals that cannot be a single spacing (missed mark, turn). */
+        if ((ratio > 0.6f) && (ratio < 1.6f))
+        {
+            g_pose_speed_scale *= 1.0f + POSE_MARK_GAIN * (ratio - 1.0f);
+            if (g_pose_speed_scale < 0.5f)
+            {
+                g_pose_speed_scale = 0.5f;
+            }
+            else if (g_pose_speed_scale > 2.0f)
+            {
+                g_pose_speed_scale = 2.0f;
+            }
+        }
+    }
+#endif
+
+    g_pose_mark_seen = 1U;
+    g_pose_path_since_mark_mm = 0.0f;
+}
+
+void Pose_OnWallObservation(const SensorSnapshot *snapshot)
+{
+    float delta_mm;
+    float relative;
+    float wall_axis;
+    float corrected;
+
+    if (snapshot == NULL)
+    {
+        return;
+    }
+
+    if (g_pose_straight == 0U)
+    {
+        Pose_StartWallSegment(snapshot);
+        return;
+    }
+
+    if (g_pose_segment_mm < (float)POSE_WALL_SEGMENT_MM)
+    {
+        return;
+    }
+
+    /* Prefer the nearer wall; both readings must stay inside the trusted range. */
+    if ((snapshot->left_cm <= snapshot->right_cm) &&
+        (snapshot->left_cm < POSE_WALL_MAX_CM) && (g_pose_segment_left_cm < POSE_WALL_MAX_CM))
+    {
+        /* Left wall getting farther means the car points away from it (clockwise). */
+        delta_mm = 10.0f * ((float)snapshot->left_cm - (float)g_pose_segment_left_cm);
+        relative = -delta_mm / g_pose_segment_mm;
+    }
+    else if ((snapshot->right_cm < POSE_WALL_MAX_CM) && (g_pose_segment_right_cm < POSE_WALL_MAX_CM))
+    {
+        delta_mm = 10.0f * ((float)snapshot->right_cm - (float)g_pose_segment_right_cm);
+        relative = delta_mm / g_pose_segment_mm;
+    }
+    else
+    {
+        Pose_StartWallSegment(snapshot);
+        return;
+    }
+
+    /* Large slopes are a wall corner or an opening, not a heading error. */
+    if ((relative > -0.35f) && (relative < 0.35f))
+    {
+        relative = asinf(relative);
+        wall_axis = POSE_HALF_PI * floorf((g_pose_heading_rad - relative) / POSE_HALF_PI + 0.5f);
+        corrected = wall_axis + relative;
+        g_pose_heading_rad = Pose_WrapAngle(
+            g_pose_heading_rad + POSE_WALL_GAIN * Pose_WrapAngle(corrected - g_pose_heading_rad));
+    }
+
+    Pose_StartWallSegment(snapshot);
+}
+
+void Pose_Get(NavPose *pose)
+{
+    if (pose == NULL)
+    {
+        return;
+    }
+
+    pose->x_mm = (int32_t)g_pose_x_mm;
+    pose->y_mm = (int32_t)g_pose_y_mm;
+    pose->heading_ddeg = (int16_t)(g_pose_heading_rad * (1800.0f / POSE_PI));
+}
+
+float Pose_GetHeadingRad(void)
+{
+    return g_pose_heading_rad;
+}
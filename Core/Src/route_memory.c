@@ -0,0 +1,252 @@
+#include "route_memory.h"
+
+#include <math.h>
+#include <stddef.h>
+
+#include "app_config.h"
+
+/*
+ * Topological memory of branch points (scene 2 decisions) and dead ends
+ * (scene 5). A branch is identified by the mark count when it was reached
+ * plus either its dead-reckoned position or its timing signature (time since
+ * the last mark), so it is still recognized after the pose has drifted.
+ * When a dead end follows a branch, the branch side that led there is
+ * flagged and later visits prefer the other side. Dead ends are also kept
+ * by position, so a branch that was never recorded (or lost to the ring)
+ * still avoids the side that points at one reached since the same mark.
+ */
+
+#define ROUTE_DEAD_LEFT     0x01U
+#define ROUTE_DEAD_RIGHT    0x02U
+
+#define ROUTE_DDEG_TO_RAD   (3.14159265f / 1800.0f)
+
+typedef struct
+{
+    int32_t x_mm;
+    int32_t y_mm;
+    uint32_t since_mark_ms;
+    uint8_t mark_count;
+    uint8_t dead_mask;
+    uint8_t taken;
+} RouteBranch;
+
+typedef struct
+{
+    int32_t x_mm;
+    int32_t y_mm;
+    uint8_t mark_count;
+} RouteDeadEnd;
+
+static RouteBranch g_route_branches[ROUTE_MAX_BRANCHES];
+static uint8_t g_route_branch_count = 0U;
+static uint8_t g_route_branch_next = 0U;
+static int8_t g_route_last_branch = -1;
+
+static RouteDeadEnd g_route_dead_ends[ROUTE_MAX_DEAD_ENDS];
+static uint8_t g_route_dead_end_count = 0U;
+static uint8_t g_route_dead_end_next = 0U;
+
+static uint32_t g_route_last_mark_ms = 0U;
+static RouteStats g_route_stats;
+
+static uint32_t Route_AbsDiff(uint32_t a, uint32_t b)
+{
+    return (a > b) ? (a - b) : (b - a);
+}
+
+static int8_t Route_FindBranch(uint8_t mark_count, const NavPose *pose, uint32_t since_mark_ms)
+{
+    uint8_t i;
+
+    for (i = 0U; i < g_route_branch_count; ++i)
+    {
+        const RouteBranch *branch = &g_route_branches[i];
+        int32_t dx = branch->x_mm - pose->x_mm;
+        int32_t dy = branch->y_mm - pose->y_mm;
+        uint8_t near_pose;
+        uint8_t same_timing;
+
+        if (branch->mark_count != mark_count)
+        {
+            continue;
+        }
+
+        near_pose = (uint8_t)(((dx * dx) + (dy * dy)) <= ((int32_t)ROUTE_MATCH_RADIUS_MM * (int32_t)ROUTE_MATCH_RADIUS_MM));
+        same_timing = (uint8_t)(Route_AbsDiff(branch->since_mark_ms, since_mark_ms) <= ROUTE_MATCH_TIME_MS);
+        if ((near_pose != 0U) || (same_timing != 0U))
+        {
+            return (int8_t)i;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * Sides whose 90 degree turn points at a recorded dead end: ahead of the
+ * turned heading and within ROUTE_MATCH_RADIUS_MM of that line.
+ */
+static uint8_t Route_DeadEndSides(uint8_t mark_count, const NavPose *pose)
+{
+    float heading = (float)pose->heading_ddeg * ROUTE_DDEG_TO_RAD;
+    float c = cosf(heading);
+    float s = sinf(heading);
+    uint8_t sides = 0U;
+    uint8_t i;
+
+    for (i = 0U; i < g_route_dead_end_count; ++i)
+    {
+        const RouteDeadEnd *dead_end = &g_route_dead_ends[i];
+        float dx = (float)(dead_end->x_mm - pose->x_mm);
+        float dy = (float)(dead_end->y_mm - pose->y_mm);
+        float ahead = (dx * c) + (dy * s);   /* along the current heading */
+        float left = (dy * c) - (dx * s);    /* along the left turn */
+
+        if ((dead_end->mark_count != mark_count) || (fabsf(ahead) > (float)ROUTE_MATCH_RADIUS_MM))
+        {
+            continue;
+        }
+        if (left > 0.0f)
+        {
+            sides |= ROUTE_DEAD_LEFT;
+        }
+        else if (left < 0.0f)
+        {
+            sides |= ROUTE_DEAD_RIGHT;
+        }
+    }
+
+    return sides;
+}
+
+void RouteMemory_Init(void)
+{
+    g_route_branch_count = 0U;
+    g_route_branch_next = 0U;
+    g_route_last_branch = -1;
+    g_route_dead_end_count = 0U;
+    g_route_dead_end_next = 0U;
+    g_route_last_mark_ms = 0U;
+    g_route_stats.branches = 0U;
+    g_route_stats.dead_ends = 0U;
+    g_route_stats.avoidances = 0U;
+}
+
+void RouteMemory_OnMark(uint32_t now_ms)
+{
+    g_route_last_mark_ms = now_ms;
+}
+
+RouteTurn RouteMemory_Recommend(uint8_t mark_count, const NavPose *pose, uint32_t now_ms)
+{
+    int8_t idx;
+    uint8_t dead;
+
+    if (pose == NULL)
+    {
+        return ROUTE_TURN_NONE;
+    }
+
+    idx = Route_FindBranch(mark_count, pose, now_ms - g_route_last_mark_ms);
+    dead = (idx >= 0) ? g_route_branches[idx].dead_mask : 0U;
+    if (dead == 0U)
+    {
+        dead = Route_DeadEndSides(mark_count, pose);
+    }
+
+    if (dead == ROUTE_DEAD_LEFT)
+    {
+        ++g_route_stats.avoidances;
+        return ROUTE_TURN_RIGHT;
+    }
+    if (dead == ROUTE_DEAD_RIGHT)
+    {
+        ++g_route_stats.avoidances;
+        return ROUTE_TURN_LEFT;
+    }
+
+    /* Back at a branch without a dead end behind it (loop): explore the other side. */
+    if ((idx >= 0) && (dead == 0U) && (g_route_branches[idx].taken != (uint8_t)ROUTE_TURN_NONE))
+    {
+        return (g_route_branches[idx].taken == (uint8_t)ROUTE_TURN_LEFT) ? ROUTE_TURN_RIGHT : ROUTE_TURN_LEFT;
+    }
+
+    return ROUTE_TURN_NONE;
+}
+
+void RouteMemory_OnBranch(uint8_t mark_count, const NavPose *pose, uint32_t now_ms, RouteTurn taken)
+{
+    uint32_t since_mark_ms;
+    int8_t idx;
+    RouteBranch *branch;
+
+    if (pose == NULL)
+    {
+        return;
+    }
+
+    since_mark_ms = now_ms - g_route_last_mark_ms;
+    idx = Route_FindBranch(mark_count, pose, since_mark_ms);
+    if (idx < 0)
+    {
+        /* New branch; overwrite the oldest once the table is full. */
+        idx = (int8_t)g_route_branch_next;
+        g_route_branch_next = (uint8_t)((g_route_branch_next + 1U) % ROUTE_MAX_BRANCHES);
+        if (g_route_branch_count < ROUTE_MAX_BRANCHES)
+        {
+            ++g_route_branch_count;
+        }
+        g_route_branches[idx].dead_mask = 0U;
+        ++g_route_stats.branches;
+    }
+
+    branch = &g_route_branches[idx];
+    branch->x_mm = pose->x_mm;
+    branch->y_mm = pose->y_mm;
+    branch->since_mark_ms = since_mark_ms;
+    branch->mark_count = mark_count;
+    branch->taken = (uint8_t)taken;
+    g_route_last_branch = idx;
+}
+
+void RouteMemory_OnDeadEnd(uint8_t mark_count, const NavPose *pose)
+{
+    RouteDeadEnd *event;
+
+    if (pose == NULL)
+    {
+        return;
+    }
+
+    event = &g_route_dead_ends[g_route_dead_end_next];
+    g_route_dead_end_next = (uint8_t)((g_route_dead_end_next + 1U) % ROUTE_MAX_DEAD_ENDS);
+    if (g_route_dead_end_count < ROUTE_MAX_DEAD_ENDS)
+    {
+        ++g_route_dead_end_count;
+    }
+    event->x_mm = pose->x_mm;
+    event->y_mm = pose->y_mm;
+    event->mark_count = mark_count;
+    ++g_route_stats.dead_ends;
+
+    if (g_route_last_branch >= 0)
+    {
+        RouteBranch *branch = &g_route_branches[g_route_last_branch];
+
+        if (branch->taken == (uint8_t)ROUTE_TURN_LEFT)
+        {
+            branch->dead_mask |= ROUTE_DEAD_LEFT;
+        }
+        else if (branch->taken == (uint8_t)ROUTE_TURN_RIGHT)
+        {
+            branch->dead_mask |= ROUTE_DEAD_RIGHT;
+        }
+        g_route_last_branch = -1;
+    }
+}
+
+const RouteStats *RouteMemory_GetStats(void)
+{
+    return &g_route_stats;
+}
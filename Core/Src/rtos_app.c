@@ -0,0 +1,391 @@
+#include "rtos_app.h"
+
+#if ENABLE_RTOS
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "cmsis_os2.h"
+#include "rtx_os.h"
+
+#include "bluetooth.h"
+#include "cycle_counter.h"
+#include "host_cmd.h"
+#include "nav_events.h"
+#include "navigation.h"
+#include "scheduler.h"
+#include "sensors.h"
+#include "speed_model.h"
+
+/*
+ * Thread layout:
+ * - sensors (realtime): ADC acquisition every NAV_SAMPLE_PERIOD_MS, posts SAMPLE.
+ * - control (high): drains the navigation event queue, woken by its event flag.
+ * - ui (below normal): LCD refresh.
+ * - telemetry (low): formats the status frames the control thread queues
+ *   every BLUETOOTH_STATUS_PERIOD_MS into the UART TX ring, and parses host
+ *   commands at least every SCHED_COMMAND_PERIOD_MS.
+ * Control blocks and stacks are static so stack sizes are known for the
+ * high-water marks. Load is the cycles spent in each thread's work section
+ * per report window; time a higher-priority thread takes while preempting
+ * that section is counted for both.
+ */
+
+typedef TelemetryStatus RtosStatusMsg;
+
+typedef struct
+{
+    const char *name;
+    osThreadFunc_t func;
+    osPriority_t priority;
+    uint64_t *stack;
+    uint32_t stack_size;
+} RtosThreadDef;
+
+static void RtosApp_SensorThread(void *argument);
+static void RtosApp_ControlThread(void *argument);
+static void RtosApp_UiThread(void *argument);
+static void RtosApp_TelemetryThread(void *argument);
+
+static uint64_t g_rtos_stack_sensors[RTOS_SENSOR_STACK_BYTES / 8U];
+static uint64_t g_rtos_stack_control[RTOS_CONTROL_STACK_BYTES / 8U];
+static uint64_t g_rtos_stack_ui[RTOS_UI_STACK_BYTES / 8U];
+static uint64_t g_rtos_stack_telemetry[RTOS_TELEMETRY_STACK_BYTES / 8U];
+
+static const RtosThreadDef kRtosThreads[RTOS_THREAD_COUNT] =
+{
+    {"sensors", RtosApp_SensorThread, osPriorityRealtime, g_rtos_stack_sensors, sizeof(g_rtos_stack_sensors)},
+    {"control", RtosApp_ControlThread, osPriorityHigh, g_rtos_stack_control, sizeof(g_rtos_stack_control)},
+    {"ui", RtosApp_UiThread, osPriorityBelowNormal, g_rtos_stack_ui, sizeof(g_rtos_stack_ui)},
+    {"telemetry", RtosApp_TelemetryThread, osPriorityLow, g_rtos_stack_telemetry, sizeof(g_rtos_stack_telemetry)}
+};
+
+static osRtxThread_t g_rtos_thread_cb[RTOS_THREAD_COUNT];
+static osThreadId_t g_rtos_thread_id[RTOS_THREAD_COUNT];
+static RtosThreadStats g_rtos_stats[RTOS_THREAD_COUNT];
+static volatile uint32_t g_rtos_busy_cycles[RTOS_THREAD_COUNT];
+static uint32_t g_rtos_busy_mark[RTOS_THREAD_COUNT];
+
+static volatile uint32_t g_rtos_idle_cycles = 0U;
+static uint32_t g_rtos_idle_mark = 0U;
+static uint16_t g_rtos_idle_permille = 0U;
+static uint32_t g_rtos_window_start_cycles = 0U;
+
+static osRtxMessageQueue_t g_rtos_status_queue_cb;
+static uint32_t g_rtos_status_queue_mem[(osRtxMessageQueueMemSize(RTOS_STATUS_QUEUE_DEPTH, sizeof(RtosStatusMsg)) + 3U) / 4U];
+static osMessageQueueId_t g_rtos_status_queue = NULL;
+static uint16_t g_rtos_status_dropped = 0U;
+
+/* HAL_GetTick() before the kernel starts, so the running tick continues from it. */
+static uint32_t g_rtos_tick_base_ms = 0U;
+
+static uint32_t RtosApp_MsToTicks(uint32_t ms)
+{
+    return (ms * osKernelGetTickFreq()) / 1000U;
+}
+
+static void RtosApp_AccountBusy(RtosThreadId id, uint32_t start_cycles)
+{
+    g_rtos_busy_cycles[id] += CycleCounter_Now() - start_cycles;
+    ++g_rtos_stats[id].runs;
+}
+
+static uint16_t RtosApp_Permille(uint32_t part, uint32_t whole)
+{
+    uint32_t permille;
+
+    if (whole == 0U)
+    {
+        return 0U;
+    }
+    permille = (uint32_t)(((uint64_t)part * 1000U) / whole);
+    return (uint16_t)((permille > 1000U) ? 1000U : permille);
+}
+
+/* Closes the load window; called from the telemetry thread before a report. */
+static void RtosApp_UpdateStats(void)
+{
+    uint32_t now = CycleCounter_Now();
+    uint32_t window = now - g_rtos_window_start_cycles;
+    uint32_t idle = g_rtos_idle_cycles;
+    uint8_t i;
+
+    for (i = 0U; i < (uint8_t)RTOS_THREAD_COUNT; ++i)
+    {
+        uint32_t busy = g_rtos_busy_cycles[i];
+
+        g_rtos_stats[i].load_permille = RtosApp_Permille(busy - g_rtos_busy_mark[i], window);
+        g_rtos_busy_mark[i] = busy;
+        g_rtos_stats[i].stack_used_max = g_rtos_stats[i].stack_size - osThreadGetStackSpace(g_rtos_thread_id[i]);
+    }
+
+    g_rtos_idle_permille = RtosApp_Permille(idle - g_rtos_idle_mark, window);
+    g_rtos_idle_mark = idle;
+    g_rtos_window_start_cycles = now;
+}
+
+static void RtosApp_PublishStatus(void)
+{
+    RtosStatusMsg msg;
+
+    msg.time_ms = HAL_GetTick();
+    msg.snapshot = *Sensors_GetSnapshot();
+    Navigation_GetPose(&msg.pose);
+    msg.speed = *SpeedModel_GetLastSample();
+    msg.counter = Navigation_GetCounter();
+    msg.scene = (uint8_t)Navigation_GetCurrentScene();
+    msg.motion = (uint8_t)Navigation_GetMotion();
+
+    /* Never wait here: a telemetry backlog must not hold up the control loop. */
+    if (osMessageQueuePut(g_rtos_status_queue, &msg, 0U, 0U) != osOK)
+    {
+        ++g_rtos_status_dropped;
+    }
+}
+
+static void RtosApp_SensorThread(void *argument)
+{
+    uint32_t next = osKernelGetTickCount();
+    uint32_t period = RtosApp_MsToTicks(NAV_SAMPLE_PERIOD_MS);
+
+    (void)argument;
+    for (;;)
+    {
+        uint32_t start = CycleCounter_Now();
+
+        Sensors_Update();
+        (void)NavEvents_Post(NAV_EVENT_SAMPLE, 0U, start);
+        RtosApp_AccountBusy(RTOS_THREAD_SENSORS, start);
+
+        next += period;
+        (void)osDelayUntil(next);
+    }
+}
+
+static void RtosApp_ControlThread(void *argument)
+{
+    uint32_t next_status_ms = HAL_GetTick();
+
+    (void)argument;
+    for (;;)
+    {
+        uint32_t start;
+
+        NavEvents_WaitForEvent();
+        start = CycleCounter_Now();
+        App_RunTask(SCHED_TASK_NAVIGATION);
+
+#if ENABLE_BLUETOOTH
+        if ((int32_t)(HAL_GetTick() - next_status_ms) >= 0)
+        {
+            next_status_ms = HAL_GetTick() + BLUETOOTH_STATUS_PERIOD_MS;
+            RtosApp_PublishStatus();
+        }
+#endif
+        RtosApp_AccountBusy(RTOS_THREAD_CONTROL, start);
+    }
+}
+
+static void RtosApp_UiThread(void *argument)
+{
+    uint32_t next = osKernelGetTickCount();
+    uint32_t period = RtosApp_MsToTicks(LCD_REFRESH_PERIOD_MS);
+
+    (void)argument;
+    for (;;)
+    {
+        uint32_t start;
+
+        next += period;
+        (void)osDelayUntil(next);
+
+        start = CycleCounter_Now();
+        App_RunTask(SCHED_TASK_LCD);
+        RtosApp_AccountBusy(RTOS_THREAD_UI, start);
+    }
+}
+
+#if ENABLE_BLUETOOTH
+static void RtosApp_SendThreadStats(void)
+{
+    char line[96];
+    uint8_t i;
+
+    for (i = 0U; i < (uint8_t)RTOS_THREAD_COUNT; ++i)
+    {
+        const RtosThreadStats *stats = &g_rtos_stats[i];
+
+        (void)snprintf(
+            line,
+            sizeof(line),
+            "thread=%s,runs=%lu,load=%u,stack=%lu/%lu\r\n",
+            kRtosThreads[i].name,
+            (unsigned long)stats->runs,
+            (unsigned int)stats->load_permille,
+            (unsigned long)stats->stack_used_max,
+            (unsigned long)stats->stack_size);
+        Bluetooth_SendText(line);
+    }
+
+    (void)snprintf(
+        line,
+        sizeof(line),
+        "thread=idle,load=%u,status_drop=%u\r\n",
+        (unsigned int)g_rtos_idle_permille,
+        (unsigned int)g_rtos_status_dropped);
+    Bluetooth_SendText(line);
+    App_SendModuleStats();
+    Bluetooth_SendTxStats();
+    Bluetooth_SendRxStats();
+    HostCmd_SendStats();
+}
+#endif
+
+static void RtosApp_TelemetryThread(void *argument)
+{
+    RtosStatusMsg msg;
+    uint8_t reports = 0U;
+    uint32_t poll = RtosApp_MsToTicks(SCHED_COMMAND_PERIOD_MS);
+
+    (void)argument;
+    for (;;)
+    {
+        uint32_t start;
+        osStatus_t got = osMessageQueueGet(g_rtos_status_queue, &msg, NULL, poll);
+
+        start = CycleCounter_Now();
+        App_RunTask(SCHED_TASK_COMMAND);
+        if (got != osOK)
+        {
+            RtosApp_AccountBusy(RTOS_THREAD_TELEMETRY, start);
+            continue;
+        }
+
+        if (++reports >= SCHED_REPORT_EVERY)
+        {
+            reports = 0U;
+            RtosApp_UpdateStats();
+#if ENABLE_BLUETOOTH
+            RtosApp_SendThreadStats();
+#endif
+        }
+#if ENABLE_BLUETOOTH
+        Bluetooth_SendStatus(&msg);
+#endif
+        RtosApp_AccountBusy(RTOS_THREAD_TELEMETRY, start);
+    }
+}
+
+uint8_t RtosApp_InitKernel(void)
+{
+    return (uint8_t)(osKernelInitialize() == osOK);
+}
+
+void RtosApp_Start(void)
+{
+    osMessageQueueAttr_t queue_attr = {0};
+    uint8_t i;
+
+    queue_attr.name = "status";
+    queue_attr.cb_mem = &g_rtos_status_queue_cb;
+    queue_attr.cb_size = sizeof(g_rtos_status_queue_cb);
+    queue_attr.mq_mem = g_rtos_status_queue_mem;
+    queue_attr.mq_size = sizeof(g_rtos_status_queue_mem);
+    g_rtos_status_queue = osMessageQueueNew(RTOS_STATUS_QUEUE_DEPTH, sizeof(RtosStatusMsg), &queue_attr);
+    if (g_rtos_status_queue == NULL)
+    {
+        return;
+    }
+
+    for (i = 0U; i < (uint8_t)RTOS_THREAD_COUNT; ++i)
+    {
+        osThreadAttr_t attr = {0};
+
+        attr.name = kRtosThreads[i].name;
+        attr.cb_mem = &g_rtos_thread_cb[i];
+        attr.cb_size = sizeof(g_rtos_thread_cb[i]);
+        attr.stack_mem = kRtosThreads[i].stack;
+        attr.stack_size = kRtosThreads[i].stack_size;
+        attr.priority = kRtosThreads[i].priority;
+
+        g_rtos_stats[i].runs = 0U;
+        g_rtos_stats[i].load_permille = 0U;
+        g_rtos_stats[i].stack_size = kRtosThreads[i].stack_size;
+        g_rtos_stats[i].stack_used_max = 0U;
+        g_rtos_busy_cycles[i] = 0U;
+        g_rtos_busy_mark[i] = 0U;
+
+        g_rtos_thread_id[i] = osThreadNew(kRtosThreads[i].func, NULL, &attr);
+        if (g_rtos_thread_id[i] == NULL)
+        {
+            return;
+        }
+    }
+
+    g_rtos_tick_base_ms = HAL_GetTick();
+    g_rtos_window_start_cycles = CycleCounter_Now();
+    (void)osKernelStart();
+}
+
+const RtosThreadStats *RtosApp_GetStats(RtosThreadId id)
+{
+    if (id >= RTOS_THREAD_COUNT)
+    {
+        return NULL;
+    }
+    return &g_rtos_stats[id];
+}
+
+const char *RtosApp_GetThreadName(RtosThreadId id)
+{
+    if (id >= RTOS_THREAD_COUNT)
+    {
+        return "?";
+    }
+    return kRtosThreads[id].name;
+}
+
+uint16_t RtosApp_GetIdlePermille(void)
+{
+    return g_rtos_idle_permille;
+}
+
+/* Replaces the weak RTX idle thread: sleep and count the cycles spent asleep. */
+__NO_RETURN void osRtxIdleThread(void *argument)
+{
+    (void)argument;
+    for (;;)
+    {
+        uint32_t start = CycleCounter_Now();
+
+        __WFI();
+        g_rtos_idle_cycles += CycleCounter_Now() - start;
+    }
+}
+
+/* RTX owns SysTick; HAL time is derived from the kernel tick (OS_TICK_FREQ 1000). */
+HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority)
+{
+    (void)TickPriority;
+    return HAL_OK;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    osKernelState_t state = osKernelGetState();
+    uint32_t cycles_per_ms = SystemCoreClock / 1000U;
+
+    if ((state == osKernelRunning) || (state == osKernelLocked))
+    {
+        return g_rtos_tick_base_ms + osKernelGetTickCount();
+    }
+
+    /* Before osKernelStart(): the DWT counter, valid for the first 51 s after reset. */
+    if (cycles_per_ms == 0U)
+    {
+        return 0U;
+    }
+    return CycleCounter_Now() / cycles_per_ms;
+}
+
+#endif /* ENABLE_RTOS */
@@ -0,0 +1,136 @@
+#include "scan_profile.h"
+
+#include <stddef.h>
+
+#include "app_config.h"
+
+/*
+ * Angular clearance profile of one scan sweep. The arc around the scan center
+ * is split into SCAN_BINS bins; each bin keeps the shortest front distance
+ * sampled while the heading was inside it, so one far reading through a gap
+ * narrower than a bin does not make that bin look open.
+ */
+
+#define SCAN_PROFILE_PI     3.14159265f
+#define SCAN_BIN_UNSEEN     0U
+
+#if ((SCAN_BINS % 2U) == 0U) || (SCAN_BINS < 3U)
+#error "SCAN_BINS must be odd and at least 3"
+#endif
+
+#if (SCAN_ARC_DEG < 30U) || (SCAN_ARC_DEG > 300U)
+#error "SCAN_ARC_DEG must stay between 30 and 300 degrees"
+#endif
+
+static uint8_t g_scan_bins[SCAN_BINS];
+static float g_scan_center_rad = 0.0f;
+
+static float ScanProfile_BinWidthRad(void)
+{
+    return ((float)SCAN_ARC_DEG * (SCAN_PROFILE_PI / 180.0f)) / (float)SCAN_BINS;
+}
+
+void ScanProfile_Begin(float center_rad)
+{
+    uint8_t i;
+
+    g_scan_center_rad = center_rad;
+    for (i = 0U; i < SCAN_BINS; ++i)
+    {
+        g_scan_bins[i] = SCAN_BIN_UNSEEN;
+    }
+}
+
+float ScanProfile_Offset(float heading_rad)
+{
+    float offset = heading_rad - g_scan_center_rad;
+
+    while (offset > SCAN_PROFILE_PI)
+    {
+        offset -= 2.0f * SCAN_PROFILE_PI;
+    }
+    while (offset < -SCAN_PROFILE_PI)
+    {
+        offset += 2.0f * SCAN_PROFILE_PI;
+    }
+
+    return offset;
+}
+
+void ScanProfile_AddSample(float heading_rad, uint16_t front_cm)
+{
+    float offset = ScanProfile_Offset(heading_rad);
+    float position;
+    uint8_t bin;
+
+    /* Bin 0 is the rightmost edge of the arc. */
+    position = (offset / ScanProfile_BinWidthRad()) + ((float)SCAN_BINS / 2.0f);
+    if ((position < 0.0f) || (position >= (float)SCAN_BINS))
+    {
+        return;
+    }
+    bin = (uint8_t)position;
+
+    if (front_cm > 0xFFU)
+    {
+        front_cm = 0xFFU;
+    }
+    if (front_cm == SCAN_BIN_UNSEEN)
+    {
+        front_cm = 1U;
+    }
+
+    if ((g_scan_bins[bin] == SCAN_BIN_UNSEEN) || (front_cm < g_scan_bins[bin]))
+    {
+        g_scan_bins[bin] = (uint8_t)front_cm;
+    }
+}
+
+/*
+ * Score of a bin: the worst clearance of the bin and its neighbours, since the
+ * car body is wider than the sensor beam. Unseen bins count as blocked.
+ * Ties go to the bin closest to the center (smallest turn).
+ */
+uint8_t ScanProfile_GetBestOffset(uint16_t min_clear_cm, float *offset_rad)
+{
+    const uint8_t center = (uint8_t)(SCAN_BINS / 2U);
+    uint8_t best_bin = center;
+    uint8_t best_score = 0U;
+    uint8_t best_distance = 0xFFU;
+    uint8_t i;
+
+    if (offset_rad == NULL)
+    {
+        return 0U;
+    }
+
+    for (i = 0U; i < SCAN_BINS; ++i)
+    {
+        uint8_t score = g_scan_bins[i];
+        uint8_t distance = (i > center) ? (uint8_t)(i - center) : (uint8_t)(center - i);
+
+        if ((i > 0U) && (g_scan_bins[i - 1U] < score))
+        {
+            score = g_scan_bins[i - 1U];
+        }
+        if ((i + 1U < SCAN_BINS) && (g_scan_bins[i + 1U] < score))
+        {
+            score = g_scan_bins[i + 1U];
+        }
+
+        if ((score > best_score) || ((score == best_score) && (distance < best_distance)))
+        {
+            best_score = score;
+            best_bin = i;
+            best_distance = distance;
+        }
+    }
+
+    if (best_score < min_clear_cm)
+    {
+        return 0U;
+    }
+
+    *offset_rad = ((float)best_bin - (float)center) * ScanProfile_BinWidthRad();
+    return 1U;
+}
@@ -0,0 +1,146 @@
+#include "scheduler.h"
+
+#include <stddef.h>
+
+#include "app_config.h"
+#include "cycle_counter.h"
+#include "nav_events.h"
+
+/*
+ * Period 0 marks an event-driven task: it is ready whenever its event source
+ * has work, and its deadline is an execution budget. Periodic tasks are
+ * released at offset + n * period, so release times never drift; a lower
+ * priority value wins when several tasks are ready.
+ */
+typedef struct
+{
+    const char *name;
+    uint16_t period_ms;
+    uint16_t offset_ms;
+    uint16_t deadline_ms;
+    uint8_t priority;
+} SchedTask;
+
+static const SchedTask kSchedTasks[SCHED_TASK_COUNT] =
+{
+    {"nav", 0U, 0U, SCHED_NAV_BUDGET_MS, 0U},
+    {"telemetry", BLUETOOTH_STATUS_PERIOD_MS, SCHED_TELEMETRY_OFFSET_MS, SCHED_TELEMETRY_DEADLINE_MS, 2U},
+    {"lcd", LCD_REFRESH_PERIOD_MS, SCHED_LCD_OFFSET_MS, SCHED_LCD_DEADLINE_MS, 1U},
+    {"cmd", SCHED_COMMAND_PERIOD_MS, SCHED_COMMAND_OFFSET_MS, SCHED_COMMAND_DEADLINE_MS, 3U}
+};
+
+#if (SCHED_TELEMETRY_OFFSET_MS >= BLUETOOTH_STATUS_PERIOD_MS) || (SCHED_LCD_OFFSET_MS >= LCD_REFRESH_PERIOD_MS) || \
+    (SCHED_COMMAND_OFFSET_MS >= SCHED_COMMAND_PERIOD_MS)
+#error "Scheduler phase offsets must be shorter than the task period"
+#endif
+
+static uint32_t g_sched_release_ms[SCHED_TASK_COUNT];
+static SchedTaskStats g_sched_stats[SCHED_TASK_COUNT];
+
+static uint8_t Scheduler_IsReady(uint8_t id, uint32_t now_ms)
+{
+    if (kSchedTasks[id].period_ms == 0U)
+    {
+        return NavEvents_HasPending();
+    }
+    return (uint8_t)((int32_t)(now_ms - g_sched_release_ms[id]) >= 0);
+}
+
+static void Scheduler_Run(uint8_t id, uint32_t now_ms)
+{
+    const SchedTask *task = &kSchedTasks[id];
+    SchedTaskStats *stats = &g_sched_stats[id];
+    uint32_t release_ms = (task->period_ms != 0U) ? g_sched_release_ms[id] : now_ms;
+    uint32_t jitter_ms = now_ms - release_ms;
+    uint32_t start_cycles = CycleCounter_Now();
+    uint32_t exec_us;
+
+    App_RunTask((SchedTaskId)id);
+
+    exec_us = CycleCounter_ToMicros(CycleCounter_Now() - start_cycles);
+    ++stats->runs;
+    stats->last_exec_us = exec_us;
+    if (exec_us > stats->max_exec_us)
+    {
+        stats->max_exec_us = exec_us;
+    }
+    if (jitter_ms > stats->max_jitter_ms)
+    {
+        stats->max_jitter_ms = jitter_ms;
+    }
+    if ((jitter_ms * 1000U + exec_us) > ((uint32_t)task->deadline_ms * 1000U))
+    {
+        ++stats->deadline_misses;
+    }
+
+    if (task->period_ms != 0U)
+    {
+        g_sched_release_ms[id] += task->period_ms;
+
+        /* After a long overrun, drop the lost releases instead of running back to back. */
+        while ((int32_t)(HAL_GetTick() - g_sched_release_ms[id]) >= (int32_t)task->period_ms)
+        {
+            g_sched_release_ms[id] += task->period_ms;
+            ++stats->skipped_releases;
+        }
+    }
+}
+
+void Scheduler_Init(uint32_t now_ms)
+{
+    uint8_t i;
+
+    for (i = 0U; i < (uint8_t)SCHED_TASK_COUNT; ++i)
+    {
+        g_sched_release_ms[i] = now_ms + kSchedTasks[i].offset_ms;
+        g_sched_stats[i].runs = 0U;
+        g_sched_stats[i].last_exec_us = 0U;
+        g_sched_stats[i].max_exec_us = 0U;
+        g_sched_stats[i].max_jitter_ms = 0U;
+        g_sched_stats[i].deadline_misses = 0U;
+        g_sched_stats[i].skipped_releases = 0U;
+    }
+}
+
+void Scheduler_RunOnce(void)
+{
+    uint32_t now_ms = HAL_GetTick();
+    uint8_t best = (uint8_t)SCHED_TASK_COUNT;
+    uint8_t i;
+
+    for (i = 0U; i < (uint8_t)SCHED_TASK_COUNT; ++i)
+    {
+        if ((Scheduler_IsReady(i, now_ms) != 0U) &&
+            ((best == (uint8_t)SCHED_TASK_COUNT) || (kSchedTasks[i].priority < kSchedTasks[best].priority)))
+        {
+            best = i;
+        }
+    }
+
+    if (best == (uint8_t)SCHED_TASK_COUNT)
+    {
+        /* Every release and every navigation event is raised by an interrupt. */
+        NavEvents_WaitForEvent();
+        return;
+    }
+
+    Scheduler_Run(best, now_ms);
+}
+
+const SchedTaskStats *Scheduler_GetStats(SchedTaskId id)
+{
+    if (id >= SCHED_TASK_COUNT)
+    {
+        return NULL;
+    }
+    return &g_sched_stats[id];
+}
+
+const char *Scheduler_GetTaskName(SchedTaskId id)
+{
+    if (id >= SCHED_TASK_COUNT)
+    {
+        return NULL;
+    }
+    return kSchedTasks[id].name;
+}
@@ -1,10 +1,25 @@
 #include "sensors.h"
 
 #include "app_config.h"
+#include "cycle_counter.h"
 #include "pin_map.h"
 
+#if DRIVER_BACKEND_LL
+#include "stm32f4xx_ll_adc.h"
+
+#define SENSORS_ADC_STAB_US     3U  /* tSTAB after ADON */
+#define SENSORS_ADC_TIMEOUT_MS  5U
+#endif
+
 static ADC_HandleTypeDef *g_adc = NULL;
 static SensorSnapshot g_snapshot;
+/*
+ * Sensors_Update() fills g_snapshot and publishes it; the consumer reads its
+ * own latched copy, so an acquisition running in another thread never
+ * changes a snapshot in the middle of a decision.
+ */
+static SensorSnapshot g_snapshot_published;
+static SensorSnapshot g_snapshot_latched;
 
 static uint16_t g_opb_filter = 0U;
 static uint16_t g_front_filter = 0U;
@@ -17,6 +32,19 @@ static uint32_t g_mark_candidate_since = 0U;
 static uint32_t g_mark_last_edge_ms = 0U;
 static uint8_t g_mark_edge_latched = 0U;
 
+static uint16_t g_mark_raw_prev = 0U;
+static uint32_t g_mark_raw_prev_cycles = 0U;
+static uint32_t g_mark_enter_cycles = 0U;
+static uint32_t g_mark_exit_cycles = 0U;
+static uint32_t g_mark_leading_cycles = 0U;
+static uint8_t g_mark_leading_valid = 0U;
+static MarkPass g_mark_pass;
+static uint8_t g_mark_pass_latched = 0U;
+
+static uint16_t g_front_prev_cm = 0U;
+static uint32_t g_front_prev_ms = 0U;
+static int32_t g_front_closing_filter = 0;
+
 static uint16_t FilterIir(uint16_t previous, uint16_t input)
 {
     if (previous == 0U)
@@ -26,6 +54,58 @@ static uint16_t FilterIir(uint16_t previous, uint16_t input)
     return (uint16_t)(((uint32_t)previous * 3U + (uint32_t)input) / 4U);
 }
 
+#if DRIVER_BACKEND_LL
+/* The ADC stays enabled (Sensors_Init); a read is rank-1 select, start, poll EOC. */
+static uint16_t Sensors_ReadChannel(uint32_t channel)
+{
+    ADC_TypeDef *adc;
+    uint32_t ll_channel;
+    uint32_t timeout_cycles;
+    uint32_t start;
+
+    if (g_adc == NULL)
+    {
+        return 0U;
+    }
+
+    adc = g_adc->Instance;
+    ll_channel = __LL_ADC_DECIMAL_NB_TO_CHANNEL(channel);
+    LL_ADC_SetChannelSamplingTime(adc, ll_channel, LL_ADC_SAMPLINGTIME_84CYCLES);
+    LL_ADC_REG_SetSequencerRanks(adc, LL_ADC_REG_RANK_1, ll_channel);
+
+    /* A conversion that finished after an earlier timeout must not be read as this one. */
+    LL_ADC_ClearFlag_EOCS(adc);
+    LL_ADC_ClearFlag_OVR(adc);
+    LL_ADC_REG_StartConversionSWStart(adc);
+
+    timeout_cycles = (SystemCoreClock / 1000U) * SENSORS_ADC_TIMEOUT_MS;
+    start = CycleCounter_Now();
+    while (LL_ADC_IsActiveFlag_EOCS(adc) == 0U)
+    {
+        if ((CycleCounter_Now() - start) > timeout_cycles)
+        {
+            return 0U;
+        }
+    }
+    return LL_ADC_REG_ReadConversionData12(adc);
+}
+
+static void Sensors_EnableAdc(void)
+{
+    uint32_t start;
+
+    if ((g_adc == NULL) || (LL_ADC_IsEnabled(g_adc->Instance) != 0U))
+    {
+        return;
+    }
+
+    LL_ADC_Enable(g_adc->Instance);
+    start = CycleCounter_Now();
+    while ((CycleCounter_Now() - start) < ((SystemCoreClock / 1000000U) * SENSORS_ADC_STAB_US))
+    {
+    }
+}
+#else
 static uint16_t Sensors_ReadChannel(uint32_t channel)
 {
     ADC_ChannelConfTypeDef config = {0};
@@ -60,6 +140,49 @@ static uint16_t Sensors_ReadChannel(uint32_t channel)
         return value;
     }
 }
+#endif
+
+uint16_t Sensors_AdcToDistanceCm(uint16_t adc_value)
+{
+    uint32_t cm;
+
+    /* 2Y0A21: output voltage is roughly linear in 1/distance above a small offset. */
+    if (adc_value <= IR_RANGE_OFFSET_ADC)
+    {
+        return IR_RANGE_MAX_CM;
+    }
+
+    cm = IR_RANGE_K_ADC_CM / ((uint32_t)adc_value - IR_RANGE_OFFSET_ADC);
+    if (cm > IR_RANGE_MAX_CM)
+    {
+        cm = IR_RANGE_MAX_CM;
+    }
+    else if (cm < IR_RANGE_MIN_CM)
+    {
+        cm = IR_RANGE_MIN_CM;
+    }
+    return (uint16_t)cm;
+}
+
+static void Sensors_UpdateClosingRate(uint32_t now)
+{
+    uint32_t dt = now - g_front_prev_ms;
+    int32_t rate;
+
+    if ((g_front_prev_ms == 0U) || (dt == 0U))
+    {
+        g_front_prev_cm = g_snapshot.front_cm;
+        g_front_prev_ms = now;
+        return;
+    }
+
+    rate = (((int32_t)g_front_prev_cm - (int32_t)g_snapshot.front_cm) * 1000) / (int32_t)dt;
+    g_front_closing_filter = (g_front_closing_filter * 3 + rate) / 4;
+    g_snapshot.front_closing_cm_s = (int16_t)g_front_closing_filter;
+
+    g_front_prev_cm = g_snapshot.front_cm;
+    g_front_prev_ms = now;
+}
 
 static uint8_t IsMarkRawDetected(uint16_t adc_value)
 {
@@ -70,24 +193,82 @@ static uint8_t IsMarkRawDetected(uint16_t adc_value)
 #endif
 }
 
+/* Time at which the raw reading crossed the threshold between the previous and this sample. */
+static uint32_t Sensors_InterpolateCrossing(uint16_t raw, uint32_t now_cycles)
+{
+    int32_t span = (int32_t)raw - (int32_t)g_mark_raw_prev;
+    int32_t part = (int32_t)MARK_ADC_THRESHOLD - (int32_t)g_mark_raw_prev;
+    uint32_t dt = now_cycles - g_mark_raw_prev_cycles;
+
+    if ((span == 0) || (g_mark_raw_prev_cycles == 0U))
+    {
+        return now_cycles;
+    }
+    if (span < 0)
+    {
+        span = -span;
+        part = -part;
+    }
+
+    return g_mark_raw_prev_cycles + (uint32_t)(((uint64_t)dt * (uint32_t)part) / (uint32_t)span);
+}
+
+static void Sensors_TrackMarkCrossing(uint16_t raw, uint32_t now_cycles)
+{
+    uint8_t was_mark = IsMarkRawDetected(g_mark_raw_prev);
+    uint8_t is_mark = IsMarkRawDetected(raw);
+
+    if ((g_mark_raw_prev_cycles != 0U) && (is_mark != was_mark))
+    {
+        if (is_mark != 0U)
+        {
+            g_mark_enter_cycles = Sensors_InterpolateCrossing(raw, now_cycles);
+        }
+        else
+        {
+            g_mark_exit_cycles = Sensors_InterpolateCrossing(raw, now_cycles);
+        }
+    }
+
+    g_mark_raw_prev = raw;
+    g_mark_raw_prev_cycles = now_cycles;
+}
+
 void Sensors_Init(ADC_HandleTypeDef *hadc)
 {
     g_adc = hadc;
+#if DRIVER_BACKEND_LL
+    Sensors_EnableAdc();
+#endif
 
     g_snapshot.opb704_adc = 0U;
     g_snapshot.front_adc = 0U;
     g_snapshot.left_adc = 0U;
     g_snapshot.right_adc = 0U;
+    g_snapshot.front_cm = IR_RANGE_MAX_CM;
+    g_snapshot.left_cm = IR_RANGE_MAX_CM;
+    g_snapshot.right_cm = IR_RANGE_MAX_CM;
+    g_snapshot.front_closing_cm_s = 0;
     g_snapshot.mark_detected = 0U;
     g_snapshot.front_blocked = 0U;
     g_snapshot.left_blocked = 0U;
     g_snapshot.right_blocked = 0U;
+    g_snapshot_published = g_snapshot;
+    g_snapshot_latched = g_snapshot;
 
     g_mark_stable = 0U;
     g_mark_candidate = 0U;
     g_mark_candidate_since = HAL_GetTick();
     g_mark_last_edge_ms = 0U;
     g_mark_edge_latched = 0U;
+    g_mark_raw_prev = 0U;
+    g_mark_raw_prev_cycles = 0U;
+    g_mark_leading_valid = 0U;
+    g_mark_pass_latched = 0U;
+
+    g_front_prev_cm = IR_RANGE_MAX_CM;
+    g_front_prev_ms = 0U;
+    g_front_closing_filter = 0;
 }
 
 void Sensors_Update(void)
@@ -98,8 +279,11 @@ void Sensors_Update(void)
     uint16_t raw_right;
     uint8_t mark_raw;
     uint32_t now;
+    uint32_t primask;
 
     raw_opb = Sensors_ReadChannel(OPB704_ADC_CHANNEL);
+    /* Edge timing uses the raw value; the IIR filter would delay the crossing. */
+    Sensors_TrackMarkCrossing(raw_opb, CycleCounter_Now());
     raw_front = Sensors_ReadChannel(OBST_FRONT_ADC_CHANNEL);
     raw_left = Sensors_ReadChannel(OBST_LEFT_ADC_CHANNEL);
     raw_right = Sensors_ReadChannel(OBST_RIGHT_ADC_CHANNEL);
@@ -114,12 +298,22 @@ void Sensors_Update(void)
     g_snapshot.left_adc = g_left_filter;
     g_snapshot.right_adc = g_right_filter;
 
+    g_snapshot.front_cm = Sensors_AdcToDistanceCm(g_snapshot.front_adc);
+    g_snapshot.left_cm = Sensors_AdcToDistanceCm(g_snapshot.left_adc);
+    g_snapshot.right_cm = Sensors_AdcToDistanceCm(g_snapshot.right_adc);
+
+#if ENABLE_APPROACH_SPEED_SCHEDULE
+    /* Approach speed is scheduled down, so the front may be allowed closer. */
+    g_snapshot.front_blocked = (g_snapshot.front_cm <= APPROACH_BLOCK_CM) ? 1U : 0U;
+#else
     g_snapshot.front_blocked = (g_snapshot.front_adc >= OBSTACLE_ADC_THRESHOLD_25CM) ? 1U : 0U;
+#endif
     g_snapshot.left_blocked = (g_snapshot.left_adc >= OBSTACLE_ADC_THRESHOLD_25CM) ? 1U : 0U;
     g_snapshot.right_blocked = (g_snapshot.right_adc >= OBSTACLE_ADC_THRESHOLD_25CM) ? 1U : 0U;
 
     mark_raw = IsMarkRawDetected(g_snapshot.opb704_adc);
     now = HAL_GetTick();
+    Sensors_UpdateClosingRate(now);
 
     if (mark_raw != g_mark_candidate)
     {
@@ -135,19 +329,73 @@ void Sensors_Update(void)
             g_mark_edge_latched = 1U;
             g_mark_last_edge_ms = now;
         }
+
+        if (g_mark_stable != 0U)
+        {
+            g_mark_leading_cycles = g_mark_enter_cycles;
+            g_mark_leading_valid = 1U;
+        }
+        else if (g_mark_leading_valid != 0U)
+        {
+            g_mark_pass.leading_cycles = g_mark_leading_cycles;
+            g_mark_pass.trailing_cycles = g_mark_exit_cycles;
+            g_mark_pass_latched = 1U;
+            g_mark_leading_valid = 0U;
+        }
     }
 
     g_snapshot.mark_detected = g_mark_stable;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    g_snapshot_published = g_snapshot;
+    __set_PRIMASK(primask);
+}
+
+void Sensors_Latch(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    g_snapshot_latched = g_snapshot_published;
+    __set_PRIMASK(primask);
 }
 
 const SensorSnapshot *Sensors_GetSnapshot(void)
 {
-    return &g_snapshot;
+    return &g_snapshot_latched;
 }
 
 uint8_t Sensors_ConsumeMarkEdge(void)
 {
-    uint8_t latched = g_mark_edge_latched;
+    uint32_t primask = __get_PRIMASK();
+    uint8_t latched;
+
+    __disable_irq();
+    latched = g_mark_edge_latched;
     g_mark_edge_latched = 0U;
+    __set_PRIMASK(primask);
     return latched;
 }
+
+uint8_t Sensors_ConsumeMarkPass(MarkPass *pass)
+{
+    uint32_t primask;
+    uint8_t ok = 0U;
+
+    if (pass == NULL)
+    {
+        return 0U;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (g_mark_pass_latched != 0U)
+    {
+        *pass = g_mark_pass;
+        g_mark_pass_latched = 0U;
+        ok = 1U;
+    }
+    __set_PRIMASK(primask);
+    return ok;
+}
@@ -1,6 +1,6 @@
 #include "seven_seg.h"
 
-#include "pin_map.h"
+#include "gpio_pin.h"
 #include "stm32f4xx_hal.h"
 
 /* Bit order: A B C D E F G */
@@ -18,37 +18,9 @@ static const uint8_t kDigitMask[10] =
     0x6FU  /* 9 */
 };
 
-static GPIO_TypeDef *const kSegPorts[7] =
-{
-    SEG_A_GPIO_Port,
-    SEG_B_GPIO_Port,
-    SEG_C_GPIO_Port,
-    SEG_D_GPIO_Port,
-    SEG_E_GPIO_Port,
-    SEG_F_GPIO_Port,
-    SEG_G_GPIO_Port
-};
-
-static const uint16_t kSegPins[7] =
-{
-    SEG_A_Pin,
-    SEG_B_Pin,
-    SEG_C_Pin,
-    SEG_D_Pin,
-    SEG_E_Pin,
-    SEG_F_Pin,
-    SEG_G_Pin
-};
-
 static void SevenSeg_WriteMask(uint8_t mask)
 {
-    uint8_t idx;
-
-    for (idx = 0U; idx < 7U; ++idx)
-    {
-        GPIO_PinState state = ((mask & (1U << idx)) != 0U) ? GPIO_PIN_SET : GPIO_PIN_RESET;
-        HAL_GPIO_WritePin(kSegPorts[idx], kSegPins[idx], state);
-    }
+    GpioPin_StageSevenSeg(mask);
 }
 
 void SevenSeg_Init(void)
@@ -0,0 +1,191 @@
+#include "speed_model.h"
+
+#include <stddef.h>
+
+#include "app_config.h"
+#include "cycle_counter.h"
+#include "motor.h"
+#include "sensors.h"
+
+/*
+ * Ground speed from mark timing, and an online linear duty->speed model.
+ * A mark pass gives two measurements while the car drives straight ahead:
+ * MARK_SPACING_MM over the time between two leading edges (preferred), or
+ * MARK_WIDTH_MM over the time between leading and trailing edge of one mark.
+ * Each measurement is paired with the mean commanded duty over the same
+ * interval and added to a weighted least-squares fit v = a * duty + b with
+ * exponential forgetting. Two fixed prior points from the default model keep
+ * the fit well-conditioned while only one duty level has been observed.
+ */
+
+#define SPEED_MIN_PLAUSIBLE_MM_S    50.0f
+#define SPEED_MAX_PLAUSIBLE_MM_S    2000.0f
+
+typedef struct
+{
+    float w;
+    float sx;
+    float sy;
+    float sxx;
+    float sxy;
+} SpeedFit;
+
+static SpeedFit g_speed_fit;
+static float g_speed_slope = 0.0f;
+static float g_speed_offset = 0.0f;
+static SpeedSample g_speed_last;
+
+static uint32_t g_speed_prev_leading_cycles = 0U;
+static uint8_t g_speed_prev_leading_valid = 0U;
+static uint32_t g_speed_duty_sum = 0U;
+static uint16_t g_speed_duty_count = 0U;
+static uint8_t g_speed_straight = 0U;
+
+static float SpeedModel_DefaultMmS(float duty)
+{
+    if (duty <= (float)POSE_DUTY_DEADBAND_PERCENT)
+    {
+        return 0.0f;
+    }
+    return ((duty - (float)POSE_DUTY_DEADBAND_PERCENT) * (float)POSE_WHEEL_SPEED_MM_S_AT_100) /
+           (float)(100U - POSE_DUTY_DEADBAND_PERCENT);
+}
+
+static void SpeedFit_Add(SpeedFit *fit, float x, float y, float weight)
+{
+    fit->w += weight;
+    fit->sx += weight * x;
+    fit->sy += weight * y;
+    fit->sxx += weight * x * x;
+    fit->sxy += weight * x * y;
+}
+
+static void SpeedModel_Refit(void)
+{
+    SpeedFit fit = g_speed_fit;
+    const float prior_low = (float)SPEED_MODEL_PRIOR_LOW_DUTY;
+    float denom;
+
+    SpeedFit_Add(&fit, prior_low, SpeedModel_DefaultMmS(prior_low), SPEED_MODEL_PRIOR_WEIGHT);
+    SpeedFit_Add(&fit, 100.0f, SpeedModel_DefaultMmS(100.0f), SPEED_MODEL_PRIOR_WEIGHT);
+
+    denom = (fit.w * fit.sxx) - (fit.sx * fit.sx);
+    if (denom <= 0.0f)
+    {
+        return;
+    }
+
+    g_speed_slope = ((fit.w * fit.sxy) - (fit.sx * fit.sy)) / denom;
+    g_speed_offset = (fit.sy - (g_speed_slope * fit.sx)) / fit.w;
+}
+
+static void SpeedModel_AddMeasurement(float speed_mm_s, float duty, uint8_t from_spacing)
+{
+    if ((speed_mm_s < SPEED_MIN_PLAUSIBLE_MM_S) || (speed_mm_s > SPEED_MAX_PLAUSIBLE_MM_S))
+    {
+        return;
+    }
+
+    g_speed_last.speed_mm_s = (uint16_t)speed_mm_s;
+    g_speed_last.duty_percent = (uint8_t)(duty + 0.5f);
+    g_speed_last.from_spacing = from_spacing;
+    g_speed_last.valid = 1U;
+
+    g_speed_fit.w *= SPEED_MODEL_FORGET;
+    g_speed_fit.sx *= SPEED_MODEL_FORGET;
+    g_speed_fit.sy *= SPEED_MODEL_FORGET;
+    g_speed_fit.sxx *= SPEED_MODEL_FORGET;
+    g_speed_fit.sxy *= SPEED_MODEL_FORGET;
+    SpeedFit_Add(&g_speed_fit, duty, speed_mm_s, 1.0f);
+    SpeedModel_Refit();
+}
+
+static void SpeedModel_RestartInterval(void)
+{
+    g_speed_duty_sum = 0U;
+    g_speed_duty_count = 0U;
+    g_speed_straight = 1U;
+}
+
+void SpeedModel_Init(void)
+{
+    g_speed_fit.w = 0.0f;
+    g_speed_fit.sx = 0.0f;
+    g_speed_fit.sy = 0.0f;
+    g_speed_fit.sxx = 0.0f;
+    g_speed_fit.sxy = 0.0f;
+    SpeedModel_Refit();
+
+    g_speed_last.speed_mm_s = 0U;
+    g_speed_last.duty_percent = 0U;
+    g_speed_last.from_spacing = 0U;
+    g_speed_last.valid = 0U;
+
+    g_speed_prev_leading_valid = 0U;
+    SpeedModel_RestartInterval();
+}
+
+void SpeedModel_Update(void)
+{
+    MarkPass pass;
+    int8_t left_duty;
+    int8_t right_duty;
+
+    Motor_GetCommand(&left_duty, &right_duty);
+
+    /* Only straight forward driving maps duty to ground speed. */
+    if ((left_duty > 0) && (left_duty == right_duty))
+    {
+        g_speed_duty_sum += (uint32_t)left_duty;
+        ++g_speed_duty_count;
+    }
+    else
+    {
+        g_speed_straight = 0U;
+    }
+
+    if (Sensors_ConsumeMarkPass(&pass) == 0U)
+    {
+        return;
+    }
+
+    if ((g_speed_straight != 0U) && (g_speed_duty_count > 0U))
+    {
+        float duty = (float)g_speed_duty_sum / (float)g_speed_duty_count;
+        uint32_t width_us = CycleCounter_ToMicros(pass.trailing_cycles - pass.leading_cycles);
+        uint32_t spacing_us = CycleCounter_ToMicros(pass.leading_cycles - g_speed_prev_leading_cycles);
+        float width_speed = (width_us > 0U) ? (((float)MARK_WIDTH_MM * 1.0e6f) / (float)width_us) : 0.0f;
+        float spacing_speed = 0.0f;
+
+        if ((g_speed_prev_leading_valid != 0U) && (spacing_us > 0U))
+        {
+            spacing_speed = ((float)MARK_SPACING_MM * 1.0e6f) / (float)spacing_us;
+        }
+
+        /* A missed mark doubles the interval; the width estimate exposes that. */
+        if ((spacing_speed > 0.0f) &&
+            ((width_speed <= 0.0f) || ((spacing_speed > 0.6f * width_speed) && (spacing_speed < 1.6f * width_speed))))
+        {
+            SpeedModel_AddMeasurement(spacing_speed, duty, 1U);
+        }
+        else if (width_speed > 0.0f)
+        {
+            SpeedModel_AddMeasurement(width_speed, duty, 0U);
+        }
+    }
+
+    g_speed_prev_leading_cycles = pass.leading_cycles;
+    g_speed_prev_leading_valid = 1U;
+    SpeedModel_RestartInterval();
+}
+
+float SpeedModel_WheelSpeedMmS(uint8_t duty_percent)
+{
+    float speed = (g_speed_slope * (float)duty_percent) + g_speed_offset;
+    return (speed > 0.0f) ? speed : 0.0f;
+}
+
+const SpeedSample *SpeedModel_GetLastSample(void)
+{
+    return &g_speed_last;
+}
@@ -0,0 +1,139 @@
+#include "steering.h"
+
+#include "app_config.h"
+
+/*
+ * Potential-field steering for the reactive navigation mode.
+ * Each side wall pushes the car away with a force ~ 1/distance, and a close
+ * front obstacle adds a push toward the more open side. The result is a
+ * differential wheel command around the requested base speed.
+ */
+
+static int16_t g_steer_turn_filtered = 0;
+static int16_t g_steer_turn_target = 0;
+
+static int16_t Steering_Filter(int16_t turn)
+{
+    return (int16_t)((g_steer_turn_filtered * 3 + turn) / 4);
+}
+
+static int16_t Steering_Repulsion(uint16_t distance_cm)
+{
+    if (distance_cm == 0U)
+    {
+        distance_cm = 1U;
+    }
+    return (int16_t)(1000U / distance_cm);
+}
+
+static int16_t Steering_Clamp(int16_t value, int16_t low, int16_t high)
+{
+    if (value < low)
+    {
+        return low;
+    }
+    if (value > high)
+    {
+        return high;
+    }
+    return value;
+}
+
+void Steering_Reset(void)
+{
+    g_steer_turn_filtered = 0;
+    g_steer_turn_target = 0;
+}
+
+uint8_t Steering_IsSettled(void)
+{
+    return (uint8_t)(Steering_Filter(g_steer_turn_target) == g_steer_turn_filtered);
+}
+
+/*
+ * Forward duty from the front distance: cruise above APPROACH_SLOW_START_CM,
+ * ramp linearly down to APPROACH_MIN_PERCENT at APPROACH_BLOCK_CM. When the
+ * obstacle closes in faster than the remaining gap allows (time-to-contact
+ * below APPROACH_MIN_TTC_MS), the duty is cut further in proportion.
+ */
+uint8_t Steering_ScheduleSpeed(const SensorSnapshot *snapshot)
+{
+#if ENABLE_APPROACH_SPEED_SCHEDULE
+    uint32_t duty;
+    uint32_t gap_cm;
+
+    if (snapshot == NULL)
+    {
+        return APPROACH_MIN_PERCENT;
+    }
+
+    if (snapshot->front_cm >= APPROACH_SLOW_START_CM)
+    {
+        duty = APPROACH_CRUISE_PERCENT;
+    }
+    else if (snapshot->front_cm <= APPROACH_BLOCK_CM)
+    {
+        return APPROACH_MIN_PERCENT;
+    }
+    else
+    {
+        duty = APPROACH_MIN_PERCENT +
+               (((uint32_t)(snapshot->front_cm - APPROACH_BLOCK_CM) * (APPROACH_CRUISE_PERCENT - APPROACH_MIN_PERCENT)) /
+                (APPROACH_SLOW_START_CM - APPROACH_BLOCK_CM));
+    }
+
+    gap_cm = (snapshot->front_cm > APPROACH_BLOCK_CM) ? (uint32_t)(snapshot->front_cm - APPROACH_BLOCK_CM) : 0U;
+    if (snapshot->front_closing_cm_s > 0)
+    {
+        uint32_t ttc_ms = (gap_cm * 1000U) / (uint32_t)snapshot->front_closing_cm_s;
+        if (ttc_ms < APPROACH_MIN_TTC_MS)
+        {
+            duty = (duty * ttc_ms) / APPROACH_MIN_TTC_MS;
+        }
+    }
+
+    if (duty < APPROACH_MIN_PERCENT)
+    {
+        duty = APPROACH_MIN_PERCENT;
+    }
+    return (uint8_t)duty;
+#else
+    (void)snapshot;
+    return MOTOR_SPEED_FORWARD_PERCENT;
+#endif
+}
+
+void Steering_Compute(const SensorSnapshot *snapshot, uint8_t base_percent, SteeringCommand *command)
+{
+    int16_t turn;
+    int16_t left;
+    int16_t right;
+
+    if ((snapshot == NULL) || (command == NULL))
+    {
+        return;
+    }
+
+    /* Closer left wall -> larger left repulsion -> steer right (positive). */
+    turn = (int16_t)(((Steering_Repulsion(snapshot->left_cm) - Steering_Repulsion(snapshot->right_cm)) *
+                      (int16_t)STEER_SIDE_GAIN) / 10);
+
+    if (snapshot->front_cm < STEER_FRONT_AVOID_CM)
+    {
+        int16_t push = (int16_t)(((int16_t)(STEER_FRONT_AVOID_CM - snapshot->front_cm) * (int16_t)STEER_FRONT_GAIN) / 10);
+        turn = (int16_t)((snapshot->right_cm >= snapshot->left_cm) ? (turn + push) : (turn - push));
+    }
+
+    turn = Steering_Clamp(turn, -(int16_t)STEER_MAX_TURN_PERCENT, (int16_t)STEER_MAX_TURN_PERCENT);
+
+    /* First-order smoothing keeps sensor noise from making the car weave. */
+    g_steer_turn_target = turn;
+    g_steer_turn_filtered = Steering_Filter(turn);
+
+    left = Steering_Clamp((int16_t)(base_percent + g_steer_turn_filtered), 0, 100);
+    right = Steering_Clamp((int16_t)(base_percent - g_steer_turn_filtered), 0, 100);
+
+    command->left_percent = (uint8_t)left;
+    command->right_percent = (uint8_t)right;
+    command->turn_percent = (int8_t)g_steer_turn_filtered;
+}
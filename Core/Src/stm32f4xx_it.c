@@ -1,45 +1,47 @@
 #include "stm32f4xx_hal.h"
 
+#include "app_config.h"
+#include "bluetooth.h"
+#include "buzzer.h"
+#include "indicators.h"
+#include "nav_events.h"
+
 void NMI_Handler(void)
 {
 }
 
 void HardFault_Handler(void)
 {
-    while (1)
-    {
-    }
+    Indicators_FaultLoop(INDICATOR_FAULT_HARD);
 }
 
 void MemManage_Handler(void)
 {
-    while (1)
-    {
-    }
+    Indicators_FaultLoop(INDICATOR_FAULT_MEMMANAGE);
 }
 
 void BusFault_Handler(void)
 {
-    while (1)
-    {
-    }
+    Indicators_FaultLoop(INDICATOR_FAULT_BUS);
 }
 
 void UsageFault_Handler(void)
 {
-    while (1)
-    {
-    }
+    Indicators_FaultLoop(INDICATOR_FAULT_USAGE);
 }
 
+#if !ENABLE_RTOS
+/* With ENABLE_RTOS, RTX5 provides SVC, PendSV and SysTick. */
 void SVC_Handler(void)
 {
 }
+#endif
 
 void DebugMon_Handler(void)
 {
 }
 
+#if !ENABLE_RTOS
 void PendSV_Handler(void)
 {
 }
@@ -47,4 +49,31 @@ void PendSV_Handler(void)
 void SysTick_Handler(void)
 {
     HAL_IncTick();
+    NavEvents_OnTick(HAL_GetTick());
+}
+#endif
+
+void TIM1_UP_TIM10_IRQHandler(void)
+{
+    Buzzer_OnTimerIrq();
+}
+
+void TIM1_TRG_COM_TIM11_IRQHandler(void)
+{
+    Indicators_OnTimerIrq();
+}
+
+void DMA1_Stream5_IRQHandler(void)
+{
+    Bluetooth_OnRxDmaIrq();
+}
+
+void DMA1_Stream6_IRQHandler(void)
+{
+    Bluetooth_OnTxDmaIrq();
+}
+
+void USART2_IRQHandler(void)
+{
+    Bluetooth_OnUartIrq();
 }
@@ -0,0 +1,176 @@
+#include "telemetry_frame.h"
+
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * Software CRC: the F4 CRC unit only computes CRC-32 (poly 0x04C11DB7) on
+ * whole words, so it cannot produce this CRC-16. A nibble table keeps the
+ * flash cost at 32 bytes.
+ */
+static const uint16_t kCrc16Nibble[16] =
+{
+    0x0000U, 0x1021U, 0x2042U, 0x3063U, 0x4084U, 0x50A5U, 0x60C6U, 0x70E7U,
+    0x8108U, 0x9129U, 0xA14AU, 0xB16BU, 0xC18CU, 0xD1ADU, 0xE1CEU, 0xF1EFU
+};
+
+/* Frames from different threads only need distinct numbers often enough to spot gaps. */
+static uint8_t g_frame_sequence = 0U;
+
+uint16_t TelemetryFrame_Crc16(const uint8_t *data, uint32_t len)
+{
+    uint16_t crc = 0xFFFFU;
+    uint32_t i;
+
+    for (i = 0U; i < len; ++i)
+    {
+        crc = (uint16_t)((crc << 4U) ^ kCrc16Nibble[((crc >> 12U) ^ (data[i] >> 4U)) & 0x0FU]);
+        crc = (uint16_t)((crc << 4U) ^ kCrc16Nibble[((crc >> 12U) ^ data[i]) & 0x0FU]);
+    }
+    return crc;
+}
+
+/* COBS: every zero becomes the distance to the next one; no zero remains. */
+static uint32_t TelemetryFrame_Cobs(const uint8_t *in, uint32_t len, uint8_t *out)
+{
+    uint32_t code_idx = 0U;
+    uint32_t out_idx = 1U;
+    uint8_t code = 1U;
+    uint32_t i;
+
+    for (i = 0U; i < len; ++i)
+    {
+        if (in[i] == 0U)
+        {
+            out[code_idx] = code;
+            code_idx = out_idx++;
+            code = 1U;
+        }
+        else
+        {
+            out[out_idx++] = in[i];
+            if (++code == 0xFFU)
+            {
+                out[code_idx] = code;
+                code_idx = out_idx++;
+                code = 1U;
+            }
+        }
+    }
+    out[code_idx] = code;
+    return out_idx;
+}
+
+static void TelemetryFrame_PutU16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8U);
+}
+
+static void TelemetryFrame_PutU32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8U);
+    p[2] = (uint8_t)(v >> 16U);
+    p[3] = (uint8_t)(v >> 24U);
+}
+
+static void TelemetryFrame_PutAdcPair(uint8_t *p, uint16_t a, uint16_t b)
+{
+    p[0] = (uint8_t)a;
+    p[1] = (uint8_t)(((a >> 8U) & 0x0FU) | ((b & 0x0FU) << 4U));
+    p[2] = (uint8_t)(b >> 4U);
+}
+
+static uint8_t TelemetryFrame_ClampU8(uint16_t v)
+{
+    return (v > 0xFFU) ? 0xFFU : (uint8_t)v;
+}
+
+uint32_t TelemetryFrame_Encode(uint8_t type, const uint8_t *payload, uint32_t len, uint8_t *out, uint32_t out_size)
+{
+    uint8_t raw[TELEMETRY_FRAME_HEADER_BYTES + TELEMETRY_FRAME_MAX_PAYLOAD + TELEMETRY_FRAME_CRC_BYTES];
+    uint32_t raw_len;
+    uint32_t encoded;
+
+    if ((out == NULL) || (len > TELEMETRY_FRAME_MAX_PAYLOAD) || ((payload == NULL) && (len != 0U)))
+    {
+        return 0U;
+    }
+
+    raw_len = TELEMETRY_FRAME_HEADER_BYTES + len + TELEMETRY_FRAME_CRC_BYTES;
+    /* COBS adds one byte per 254 plus one; then the delimiter. */
+    if (out_size < (raw_len + (raw_len / 254U) + 2U))
+    {
+        return 0U;
+    }
+
+    raw[0] = TELEMETRY_FRAME_VERSION;
+    raw[1] = type;
+    raw[2] = g_frame_sequence++;
+    if (len != 0U)
+    {
+        memcpy(&raw[TELEMETRY_FRAME_HEADER_BYTES], payload, len);
+    }
+    TelemetryFrame_PutU16(&raw[TELEMETRY_FRAME_HEADER_BYTES + len], TelemetryFrame_Crc16(raw, TELEMETRY_FRAME_HEADER_BYTES + len));
+
+    encoded = TelemetryFrame_Cobs(raw, raw_len, out);
+    out[encoded] = 0U;
+    return encoded + 1U;
+}
+
+uint32_t TelemetryFrame_EncodeStatus(const TelemetryStatus *status, uint8_t *out, uint32_t out_size)
+{
+    uint8_t p[TELEMETRY_STATUS_PAYLOAD_BYTES];
+    const SensorSnapshot *s;
+    uint8_t flags = 0U;
+
+    if (status == NULL)
+    {
+        return 0U;
+    }
+    s = &status->snapshot;
+
+    flags |= (s->mark_detected != 0U) ? TELEMETRY_FLAG_MARK : 0U;
+    flags |= (s->front_blocked != 0U) ? TELEMETRY_FLAG_FRONT_BLOCKED : 0U;
+    flags |= (s->left_blocked != 0U) ? TELEMETRY_FLAG_LEFT_BLOCKED : 0U;
+    flags |= (s->right_blocked != 0U) ? TELEMETRY_FLAG_RIGHT_BLOCKED : 0U;
+    flags |= (status->speed.valid != 0U) ? TELEMETRY_FLAG_SPEED_VALID : 0U;
+    flags |= (status->speed.from_spacing != 0U) ? TELEMETRY_FLAG_SPEED_SPACING : 0U;
+
+    TelemetryFrame_PutU32(&p[0], status->time_ms);
+    p[4] = status->scene;
+    p[5] = status->motion;
+    p[6] = status->counter;
+    p[7] = flags;
+    TelemetryFrame_PutAdcPair(&p[8], s->opb704_adc, s->front_adc);
+    TelemetryFrame_PutAdcPair(&p[11], s->left_adc, s->right_adc);
+    p[14] = TelemetryFrame_ClampU8(s->front_cm);
+    p[15] = TelemetryFrame_ClampU8(s->left_cm);
+    p[16] = TelemetryFrame_ClampU8(s->right_cm);
+    TelemetryFrame_PutU16(&p[17], (uint16_t)s->front_closing_cm_s);
+    TelemetryFrame_PutU32(&p[19], (uint32_t)status->pose.x_mm);
+    TelemetryFrame_PutU32(&p[23], (uint32_t)status->pose.y_mm);
+    TelemetryFrame_PutU16(&p[27], (uint16_t)status->pose.heading_ddeg);
+    TelemetryFrame_PutU16(&p[29], status->speed.speed_mm_s);
+    p[31] = status->speed.duty_percent;
+
+    return TelemetryFrame_Encode(TELEMETRY_FRAME_TYPE_STATUS, p, sizeof(p), out, out_size);
+}
+
+uint32_t TelemetryFrame_EncodeText(const char *text, uint8_t *out, uint32_t out_size)
+{
+    size_t len;
+
+    if (text == NULL)
+    {
+        return 0U;
+    }
+
+    len = strlen(text);
+    if (len > TELEMETRY_FRAME_MAX_PAYLOAD)
+    {
+        len = TELEMETRY_FRAME_MAX_PAYLOAD;
+    }
+    return TelemetryFrame_Encode(TELEMETRY_FRAME_TYPE_TEXT, (const uint8_t *)text, (uint32_t)len, out, out_size);
+}
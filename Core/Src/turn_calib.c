@@ -0,0 +1,176 @@
+#include "turn_calib.h"
+
+#include <math.h>
+
+#include "app_config.h"
+#include "param_store.h"
+
+/*
+ * With a flat wall ahead at distance d, a turn of angle a leaves the
+ * opposite side sensor (right sensor after a left turn) reading about
+ * d / sin(a). That reading is smallest at exactly 90 degrees, so the
+ * magnitude gives |90 - a| and the trend over the last samples gives the
+ * sign: still falling means the turn stopped short, already rising means it
+ * went past 90. Most turns end early on their predicate, so the angle is
+ * taken against the time actually turned: the 90 degree estimate is
+ * elapsed * 90 / a, and the duration of that direction moves toward it by
+ * at most TURN_CAL_MAX_STEP_MS per turn.
+ */
+
+#define TURN_CAL_HALF_PI        1.57079633f
+#define TURN_CAL_PI             3.14159265f
+#define TURN_CAL_TREND_SAMPLES  3U
+
+static TurnCalibStats g_turn_cal_stats;
+static uint8_t g_turn_cal_armed = 0U;
+static ParamId g_turn_cal_param = PARAM_TURN_LEFT_90_MS;
+static uint8_t g_turn_cal_left = 0U;
+static uint16_t g_turn_cal_wall_cm = 0U;
+static uint32_t g_turn_cal_duration_ms = 0U;
+static uint16_t g_turn_cal_history[TURN_CAL_TREND_SAMPLES];
+static uint8_t g_turn_cal_history_count = 0U;
+
+void TurnCalib_Init(void)
+{
+    g_turn_cal_stats.updates = 0U;
+    g_turn_cal_stats.rejects = 0U;
+    g_turn_cal_armed = 0U;
+}
+
+void TurnCalib_OnTurnStart(NavActionType type, uint32_t duration_ms, const SensorSnapshot *snapshot)
+{
+    g_turn_cal_armed = 0U;
+
+#if ENABLE_TURN_CALIBRATION
+    if ((type != NAV_ACTION_TURN_LEFT_90) && (type != NAV_ACTION_TURN_RIGHT_90))
+    {
+        return;
+    }
+
+    g_turn_cal_left = (uint8_t)(type == NAV_ACTION_TURN_LEFT_90);
+    g_turn_cal_param = (g_turn_cal_left != 0U) ? PARAM_TURN_LEFT_90_MS : PARAM_TURN_RIGHT_90_MS;
+
+    /* Explicit step durations are not the learned value, so they tell nothing about it. */
+    if (duration_ms != ParamStore_Get(g_turn_cal_param))
+    {
+        return;
+    }
+
+    if ((snapshot->front_cm < TURN_CAL_MIN_WALL_CM) || (snapshot->front_cm > TURN_CAL_MAX_WALL_CM))
+    {
+        return;
+    }
+
+    g_turn_cal_wall_cm = snapshot->front_cm;
+    g_turn_cal_duration_ms = duration_ms;
+    g_turn_cal_history_count = 0U;
+    g_turn_cal_armed = 1U;
+#else
+    (void)type;
+    (void)duration_ms;
+    (void)snapshot;
+#endif
+}
+
+void TurnCalib_OnTurnSample(const SensorSnapshot *snapshot)
+{
+    uint8_t i;
+
+    if (g_turn_cal_armed == 0U)
+    {
+        return;
+    }
+
+    for (i = (uint8_t)(TURN_CAL_TREND_SAMPLES - 1U); i > 0U; --i)
+    {
+        g_turn_cal_history[i] = g_turn_cal_history[i - 1U];
+    }
+    g_turn_cal_history[0] = (g_turn_cal_left != 0U) ? snapshot->right_cm : snapshot->left_cm;
+    if (g_turn_cal_history_count < TURN_CAL_TREND_SAMPLES)
+    {
+        ++g_turn_cal_history_count;
+    }
+}
+
+void TurnCalib_OnTurnComplete(const SensorSnapshot *snapshot, uint32_t elapsed_ms)
+{
+    int32_t expected_cm;
+    int32_t trend_cm;
+    uint16_t side_cm;
+    float ratio;
+    float achieved;
+    int32_t current;
+    int32_t step;
+
+    if (g_turn_cal_armed == 0U)
+    {
+        return;
+    }
+    g_turn_cal_armed = 0U;
+
+    side_cm = (g_turn_cal_left != 0U) ? snapshot->right_cm : snapshot->left_cm;
+    expected_cm = (int32_t)g_turn_cal_wall_cm + (int32_t)TURN_CAL_SIDE_OFFSET_CM;
+
+    if ((g_turn_cal_history_count < TURN_CAL_TREND_SAMPLES) || (expected_cm <= 0) ||
+        (side_cm >= IR_RANGE_MAX_CM))
+    {
+        ++g_turn_cal_stats.rejects;
+        return;
+    }
+
+    trend_cm = (int32_t)side_cm - (int32_t)g_turn_cal_history[TURN_CAL_TREND_SAMPLES - 1U];
+    if ((trend_cm > -(int32_t)TURN_CAL_TREND_CM) && (trend_cm < (int32_t)TURN_CAL_TREND_CM))
+    {
+        /* Flat at the minimum: the turn is already close to 90 degrees. */
+        return;
+    }
+
+    ratio = (float)expected_cm / (float)side_cm;
+    if (ratio > 1.0f)
+    {
+        ratio = 1.0f;
+    }
+    achieved = asinf(ratio);
+    if (trend_cm > 0)
+    {
+        achieved = TURN_CAL_PI - achieved;
+    }
+
+    /* Outside 45..135 degrees the wall most likely was not flat or not ahead. */
+    if ((achieved < (TURN_CAL_HALF_PI * 0.5f)) || (achieved > (TURN_CAL_HALF_PI * 1.5f)))
+    {
+        ++g_turn_cal_stats.rejects;
+        return;
+    }
+
+    current = (int32_t)g_turn_cal_duration_ms;
+    step = (int32_t)(((float)elapsed_ms * (TURN_CAL_HALF_PI / achieved) - (float)current) *
+                     ((float)TURN_CAL_GAIN_PERCENT / 100.0f));
+    if (step > (int32_t)TURN_CAL_MAX_STEP_MS)
+    {
+        step = (int32_t)TURN_CAL_MAX_STEP_MS;
+    }
+    else if (step < -(int32_t)TURN_CAL_MAX_STEP_MS)
+    {
+        step = -(int32_t)TURN_CAL_MAX_STEP_MS;
+    }
+
+    if ((step != 0) && (ParamStore_Set(g_turn_cal_param, (uint16_t)(current + step)) != 0U))
+    {
+        ++g_turn_cal_stats.updates;
+    }
+}
+
+void TurnCalib_OnTurnRejected(void)
+{
+    if (g_turn_cal_armed != 0U)
+    {
+        g_turn_cal_armed = 0U;
+        ++g_turn_cal_stats.rejects;
+    }
+}
+
+const TurnCalibStats *TurnCalib_GetStats(void)
+{
+    return &g_turn_cal_stats;
+}
@@ -2,15 +2,35 @@
  * Single-file application entry for Keil Studio Cloud conversion flow.
  * The actual module implementations are pulled in as one translation unit.
  */
+/* C++ math.h declares overload templates; include it before the C-linkage block. */
+#include <math.h>
+
 extern "C" {
 #include "../Core/Src/main.c"
 #include "../Core/Src/motor.c"
+#include "../Core/Src/cycle_counter.c"
+#include "../Core/Src/gpio_out.c"
+#include "../Core/Src/gpio_pin.c"
 #include "../Core/Src/sensors.c"
 #include "../Core/Src/seven_seg.c"
 #include "../Core/Src/buzzer.c"
 #include "../Core/Src/indicators.c"
+#include "../Core/Src/hc05_link.c"
 #include "../Core/Src/bluetooth.c"
+#include "../Core/Src/telemetry_frame.c"
+#include "../Core/Src/param_store.c"
+#include "../Core/Src/steering.c"
+#include "../Core/Src/speed_model.c"
+#include "../Core/Src/pose.c"
+#include "../Core/Src/occupancy_grid.c"
+#include "../Core/Src/route_memory.c"
+#include "../Core/Src/scan_profile.c"
+#include "../Core/Src/turn_calib.c"
+#include "../Core/Src/nav_events.c"
 #include "../Core/Src/navigation.c"
+#include "../Core/Src/host_cmd.c"
+#include "../Core/Src/scheduler.c"
+#include "../Core/Src/rtos_app.c"
 #include "../Core/Src/lcd1602.c"
 #include "../Core/Src/stm32f4xx_it.c"
 #include "../Core/Src/stm32f4xx_hal_msp.c"
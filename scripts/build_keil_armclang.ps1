@@ -1,5 +1,7 @@
 param(
-    [string]$Configuration = "Debug"
+    [string]$Configuration = "Debug",
+    [ValidateSet("HAL", "LL")]
+    [string]$Backend = "HAL"
 )
 
 $ErrorActionPreference = "Stop"
@@ -15,9 +17,10 @@ $fromelf  = "C:\Keil_v5\ARM\ARMCLANG\bin\fromelf.exe"
 
 New-Item -ItemType Directory -Force Build\Obj | Out-Null
 
+# Flash sector 3 (0x0800C000, 16 KB) holds the parameter records (PARAM_FLASH_ADDR).
 @'
-LR_IROM1 0x08000000 0x00040000  {
-  ER_IROM1 0x08000000 0x00040000  {
+LR_IROM1 0x08000000 0x0000C000  {
+  ER_IROM1 0x08000000 0x0000C000  {
     *.o (RESET, +First)
     *(InRoot$$Sections)
     .ANY (+RO)
@@ -26,6 +29,11 @@ LR_IROM1 0x08000000 0x00040000  {
     .ANY (+RW +ZI)
   }
 }
+LR_IROM2 0x08010000 0x00030000  {
+  ER_IROM2 0x08010000 0x00030000  {
+    .ANY (+RO)
+  }
+}
 '@ | Set-Content -Encoding ascii Build\song.sct
 
 Remove-Item Build\Obj\*.o -ErrorAction SilentlyContinue
@@ -53,6 +61,9 @@ $commonArgs = @(
     "-DSTM32F401xC",
     "-DUSE_HAL_DRIVER"
 )
+if ($Backend -eq "LL") {
+    $commonArgs += "-DDRIVER_BACKEND_LL=1U"
+}
 
 $incArgs = @()
 foreach ($p in $includePaths) { $incArgs += @("-I", $p) }
@@ -60,12 +71,29 @@ foreach ($p in $includePaths) { $incArgs += @("-I", $p) }
 $sources = @(
     "Core\Src\main.c",
     "Core\Src\motor.c",
+    "Core\Src\cycle_counter.c",
+    "Core\Src\gpio_out.c",
+    "Core\Src\gpio_pin.c",
     "Core\Src\sensors.c",
     "Core\Src\seven_seg.c",
     "Core\Src\buzzer.c",
     "Core\Src\indicators.c",
+    "Core\Src\hc05_link.c",
     "Core\Src\bluetooth.c",
+    "Core\Src\telemetry_frame.c",
+    "Core\Src\param_store.c",
+    "Core\Src\steering.c",
+    "Core\Src\speed_model.c",
+    "Core\Src\pose.c",
+    "Core\Src\occupancy_grid.c",
+    "Core\Src\route_memory.c",
+    "Core\Src\scan_profile.c",
+    "Core\Src\turn_calib.c",
+    "Core\Src\nav_events.c",
     "Core\Src\navigation.c",
+    "Core\Src\host_cmd.c",
+    "Core\Src\scheduler.c",
+    "Core\Src\rtos_app.c",
     "Core\Src\lcd1602.c",
     "Core\Src\stm32f4xx_it.c",
     "Core\Src\stm32f4xx_hal_msp.c",
@@ -109,6 +137,7 @@ $linkArgs = @(
     "--entry=Reset_Handler",
     "--summary_stderr",
     "--map",
+    "--info=sizes,totals",
     "--list=Build\song.map",
     "--output=Build\song.axf"
 ) + @($startupObj) + $objects
@@ -119,4 +148,9 @@ if ($LASTEXITCODE -ne 0) { throw "Link failed" }
 & $fromelf --i32combined --output Build\song.hex Build\song.axf
 if ($LASTEXITCODE -ne 0) { throw "HEX generation failed" }
 
-Write-Host "Build completed: Build\\song.axf, Build\\song.hex, Build\\song.map"
+# Per-object and total Code/RO/RW/ZI for comparing the HAL and LL backends.
+$sizes = "Build\song_sizes_" + $Backend.ToLower() + ".txt"
+& $fromelf --text -z --output $sizes Build\song.axf
+if ($LASTEXITCODE -ne 0) { throw "Size report failed" }
+
+Write-Host "Build completed ($Backend backend): Build\\song.axf, Build\\song.hex, Build\\song.map, $sizes"
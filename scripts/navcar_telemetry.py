@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+"""Decode the binary telemetry stream (TELEMETRY_BINARY 1, Core/Inc/telemetry_frame.h).
+
+Usage:
+    python3 navcar_telemetry.py --port COM5 [--baud 9600]
+    python3 navcar_telemetry.py capture.bin
+    python3 navcar_telemetry.py - < capture.bin
+"""
+
+import argparse
+import struct
+import sys
+
+FRAME_VERSION = 1
+TYPE_STATUS = 0x01
+TYPE_TEXT = 0x02
+
+SCENES = {1: "S1", 2: "S2", 3: "S3", 4: "S4", 5: "S5"}
+MOTIONS = {0: "STOP", 1: "FWD", 2: "BACK", 3: "LEFT", 4: "RIGHT"}
+FLAGS = (
+    (0x01, "mark"),
+    (0x02, "front"),
+    (0x04, "left"),
+    (0x08, "right"),
+    (0x10, "speed_valid"),
+    (0x20, "speed_spacing"),
+)
+
+# time, scene, motion, counter, flags, 6 ADC bytes, cm x3, closing, x, y, heading, speed, duty
+STATUS_FORMAT = "<IBBBB6sBBBhiihHB"
+STATUS_BYTES = struct.calcsize(STATUS_FORMAT)
+
+
+class FrameError(ValueError):
+    pass
+
+
+def crc16_ccitt_false(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if (crc & 0x8000) else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0:
+            raise FrameError("zero byte inside COBS block")
+        end = i + code
+        if end > len(data):
+            raise FrameError("COBS block runs past the frame")
+        out += data[i + 1:end]
+        i = end
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def unpack_adc_pair(raw):
+    a = raw[0] | ((raw[1] & 0x0F) << 8)
+    b = (raw[1] >> 4) | (raw[2] << 4)
+    return a, b
+
+
+def decode_status(payload):
+    if len(payload) != STATUS_BYTES:
+        raise FrameError("status payload is %d bytes, expected %d" % (len(payload), STATUS_BYTES))
+    (time_ms, scene, motion, counter, flags, adc, front_cm, left_cm, right_cm,
+     closing, x_mm, y_mm, heading, speed, duty) = struct.unpack(STATUS_FORMAT, payload)
+    opb, front = unpack_adc_pair(adc[0:3])
+    left, right = unpack_adc_pair(adc[3:6])
+    return {
+        "time_ms": time_ms,
+        "scene": SCENES.get(scene, scene),
+        "motion": MOTIONS.get(motion, motion),
+        "counter": counter,
+        "flags": [name for bit, name in FLAGS if flags & bit],
+        "adc": {"opb": opb, "front": front, "left": left, "right": right},
+        "cm": {"front": front_cm, "left": left_cm, "right": right_cm},
+        "closing_cm_s": closing,
+        "x_mm": x_mm,
+        "y_mm": y_mm,
+        "heading_deg": heading / 10.0,
+        "speed_mm_s": speed,
+        "speed_duty": duty,
+    }
+
+
+def decode_frame(encoded):
+    """Decode one frame without its 0x00 delimiter."""
+    raw = cobs_decode(encoded)
+    if len(raw) < 5:
+        raise FrameError("frame too short")
+    body, crc = raw[:-2], struct.unpack("<H", raw[-2:])[0]
+    if crc16_ccitt_false(body) != crc:
+        raise FrameError("CRC mismatch")
+    version, frame_type, seq = body[0], body[1], body[2]
+    if version != FRAME_VERSION:
+        raise FrameError("unknown frame version %d" % version)
+    payload = body[3:]
+    frame = {"seq": seq, "type": frame_type}
+    if frame_type == TYPE_STATUS:
+        frame["status"] = decode_status(payload)
+    elif frame_type == TYPE_TEXT:
+        frame["text"] = payload.decode("ascii", "replace").rstrip("\r\n")
+    else:
+        frame["payload"] = payload
+    return frame
+
+
+class FrameReader(object):
+    """Splits a byte stream at 0x00 and decodes frames; tracks CRC errors and sequence gaps."""
+
+    def __init__(self):
+        self._pending = bytearray()
+        self._last_seq = None
+        self.errors = 0
+        self.lost = 0
+
+    def feed(self, data):
+        self._pending += data
+        while True:
+            end = self._pending.find(b"\x00")
+            if end < 0:
+                return
+            encoded = bytes(self._pending[:end])
+            del self._pending[:end + 1]
+            if not encoded:
+                continue
+            try:
+                frame = decode_frame(encoded)
+            except FrameError as exc:
+                self.errors += 1
+                yield {"error": str(exc), "raw": encoded}
+                continue
+            if self._last_seq is not None:
+                gap = (frame["seq"] - self._last_seq - 1) & 0xFF
+                if gap:
+                    self.lost += gap
+                    frame["lost"] = gap
+            self._last_seq = frame["seq"]
+            frame["raw"] = encoded
+            yield frame
+
+
+def format_frame(frame, show_raw):
+    if "error" in frame:
+        line = "! %s" % frame["error"]
+    elif "status" in frame:
+        s = frame["status"]
+        line = ("#%03d t=%d %s %s cnt=%d adc=%d/%d/%d/%d cm=%d/%d/%d vc=%d x=%d y=%d h=%.1f v=%d vd=%d %s" % (
+            frame["seq"], s["time_ms"], s["scene"], s["motion"], s["counter"],
+            s["adc"]["opb"], s["adc"]["front"], s["adc"]["left"], s["adc"]["right"],
+            s["cm"]["front"], s["cm"]["left"], s["cm"]["right"], s["closing_cm_s"],
+            s["x_mm"], s["y_mm"], s["heading_deg"], s["speed_mm_s"], s["speed_duty"],
+            ",".join(s["flags"])))
+    elif "text" in frame:
+        line = "#%03d %s" % (frame["seq"], frame["text"])
+    else:
+        line = "#%03d type=0x%02x %s" % (frame["seq"], frame["type"], frame["payload"].hex())
+    if frame.get("lost"):
+        line = "(lost %d) %s" % (frame["lost"], line)
+    if show_raw:
+        line += "  [%s]" % frame["raw"].hex()
+    return line
+
+
+def open_source(args):
+    if args.port:
+        import serial  # pyserial
+
+        port = serial.Serial(args.port, args.baud, timeout=0.2)
+        return lambda: port.read(256)
+    stream = sys.stdin.buffer if args.file == "-" else open(args.file, "rb")
+    return lambda: stream.read(4096)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("file", nargs="?", default="-", help="capture file, '-' for stdin")
+    parser.add_argument("--port", help="serial port of the HC-05 link")
+    parser.add_argument("--baud", type=int, default=9600)
+    parser.add_argument("--raw", action="store_true", help="also print the encoded frame bytes")
+    args = parser.parse_args()
+
+    read = open_source(args)
+    reader = FrameReader()
+    try:
+        while True:
+            data = read()
+            if not data:
+                if args.port:
+                    continue
+                break
+            for frame in reader.feed(data):
+                print(format_frame(frame, args.raw))
+                sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    print("crc_errors=%d lost_frames=%d" % (reader.errors, reader.lost), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()